@@ -0,0 +1,240 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <future>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Config.h"
+#include "Position.h"
+#include "TransTable.h"
+#include "logic.h"
+
+using namespace std;
+
+// Задание на поиск хода
+struct analysis_job
+{
+    Position pos; // Позиция
+    bool color = false; // Очередь хода
+    int depth = 8; // Наибольшая глубина итеративного углубления
+    chrono::steady_clock::time_point deadline = chrono::steady_clock::time_point::max(); // Срок ответа
+    int priority = 0; // Задания с большим приоритетом выполняются раньше
+    uint64_t node_limit = 0; // Ограничение числа узлов (0 - без ограничения)
+};
+
+// Результат задания
+struct analysis_result
+{
+    vector<move_pos> line; // Лучший ход (пустой, если ходов нет или сервис остановлен до начала задания)
+    int depth = -1; // Глубина последней завершенной итерации
+    int score = 0; // Оценка с точки зрения стороны, чей ход
+    uint64_t nodes = 0; // Просмотренные узлы
+    bool late = false; // Задание начато после срока, выполнена только первая итерация
+};
+
+// Сервис анализа: принимает задания от многих партий сразу и выполняет их на общем пуле потоков.
+// У каждого потока свой Logic (однопоточный поиск), таблица транспозиций одна на всех. Задания
+// раскладываются по очередям потоков по кругу, чтобы добавляющие не ждали одну блокировку; очередь
+// упорядочена по приоритету, затем по сроку. Освободившийся поток сравнивает вершины всех очередей и
+// берет лучшее задание сервиса, из какой бы очереди оно ни было. Время на задание - остаток до его
+// срока, первая итерация выполняется всегда, чтобы ход был и у просроченного задания
+class AnalysisService
+{
+public:
+    // settings - настройки бота (раздел "Bot"), threads - число потоков, hash_mb - размер общей таблицы
+    AnalysisService(const json& settings, const size_t threads, const size_t hash_mb)
+        : config(worker_settings(settings)), table(hash_mb), queues(max<size_t>(1, threads))
+    {
+        for (size_t i = 0; i < queues.size(); ++i)
+            workers.emplace_back([this] { worker_loop(); });
+    }
+
+    // Остановка: начатые задания доигрываются, ожидающие получают пустой результат
+    ~AnalysisService()
+    {
+        {
+            lock_guard<mutex> lock(wake_mtx);
+            quit = true;
+        }
+        wake_cv.notify_all();
+        for (auto& th : workers)
+            th.join();
+        for (auto& queue : queues)
+            for (auto& job : queue.jobs)
+                job.result.set_value(analysis_result());
+    }
+
+    // Добавление задания; результат будет доступен через future
+    future<analysis_result> submit(const analysis_job& job)
+    {
+        queued_job queued{ job, { job.priority, job.deadline, next_seq++ }, promise<analysis_result>() };
+        auto res = queued.result.get_future();
+        job_queue& queue = queues[queued.rank.seq % queues.size()];
+        // Счетчик увеличивается до того, как задание станет видно потокам, иначе поток мог бы взять
+        // задание и уменьшить счетчик раньше
+        {
+            lock_guard<mutex> lock(wake_mtx);
+            ++pending;
+        }
+        {
+            lock_guard<mutex> lock(queue.mtx);
+            queue.jobs.push_back(move(queued));
+            push_heap(queue.jobs.begin(), queue.jobs.end(), job_order);
+        }
+        wake_cv.notify_one();
+        return res;
+    }
+
+    // Число заданий, ожидающих выполнения
+    size_t queued() const
+    {
+        return pending.load();
+    }
+
+    // Число потоков сервиса
+    size_t size() const
+    {
+        return queues.size();
+    }
+
+private:
+    // Ключ порядка выполнения заданий
+    struct job_rank
+    {
+        int priority = 0;
+        chrono::steady_clock::time_point deadline;
+        uint64_t seq = 0; // Порядок поступления: при равных приоритете и сроке раньше выполняется старшее
+    };
+
+    struct queued_job
+    {
+        analysis_job job;
+        job_rank rank;
+        promise<analysis_result> result;
+    };
+
+    // Очередь потока: куча, на вершине которой лучшее задание
+    struct job_queue
+    {
+        mutex mtx;
+        vector<queued_job> jobs;
+    };
+
+    // Настройки Logic потоков: поиск однопоточный, своя таблица транспозиций не выделяется
+    static json worker_settings(json settings)
+    {
+        settings["Bot"]["Threads"] = 1;
+        settings["Bot"]["HashSizeMB"] = 0;
+        settings["Bot"]["Ponder"] = false;
+        return settings;
+    }
+
+    // true, если задание a выполняется позже задания b
+    static bool runs_later(const job_rank& a, const job_rank& b)
+    {
+        if (a.priority != b.priority)
+            return a.priority < b.priority;
+        if (a.deadline != b.deadline)
+            return a.deadline > b.deadline;
+        return a.seq > b.seq;
+    }
+
+    static bool job_order(const queued_job& a, const queued_job& b)
+    {
+        return runs_later(a.rank, b.rank);
+    }
+
+    // Лучшее задание сервиса: вершины очередей сравниваются по одной, поэтому выбранное задание может
+    // успеть забрать другой поток - тогда выбор повторяется. false, если все очереди пусты
+    bool take_best(queued_job& out)
+    {
+        while (true)
+        {
+            size_t best = queues.size();
+            job_rank best_rank;
+            for (size_t i = 0; i < queues.size(); ++i)
+            {
+                lock_guard<mutex> lock(queues[i].mtx);
+                if (!queues[i].jobs.empty() &&
+                    (best == queues.size() || runs_later(best_rank, queues[i].jobs.front().rank)))
+                {
+                    best = i;
+                    best_rank = queues[i].jobs.front().rank;
+                }
+            }
+            if (best == queues.size())
+                return false;
+            job_queue& queue = queues[best];
+            lock_guard<mutex> lock(queue.mtx);
+            if (queue.jobs.empty() || queue.jobs.front().rank.seq != best_rank.seq)
+                continue;
+            pop_heap(queue.jobs.begin(), queue.jobs.end(), job_order);
+            out = move(queue.jobs.back());
+            queue.jobs.pop_back();
+            return true;
+        }
+    }
+
+    void worker_loop()
+    {
+        Logic logic(nullptr, &config);
+        logic.share_table(&table);
+        analysis_result current;
+        logic.on_iteration = [&current](const search_info& info) {
+            current.depth = info.depth;
+            current.score = info.score;
+        };
+        while (true)
+        {
+            {
+                unique_lock<mutex> lock(wake_mtx);
+                wake_cv.wait(lock, [this] { return quit || pending > 0; });
+                if (quit)
+                    return;
+            }
+            queued_job queued;
+            if (!take_best(queued))
+            {
+                // Задание взял другой поток между проверкой и попыткой или оно еще не добавлено в очередь
+                this_thread::yield();
+                continue;
+            }
+            --pending;
+            // Поколение общей таблицы меняется раз на каждые size() начатых заданий
+            if (++started % queues.size() == 0)
+                table.new_search();
+
+            const analysis_job& job = queued.job;
+            current = analysis_result();
+            int think_time_ms = 0;
+            if (job.deadline != chrono::steady_clock::time_point::max())
+            {
+                const auto left = chrono::duration_cast<chrono::milliseconds>(job.deadline - chrono::steady_clock::now());
+                current.late = (left.count() <= 0);
+                think_time_ms = int(min<int64_t>(max<int64_t>(1, left.count()), numeric_limits<int>::max()));
+            }
+            logic.Max_depth = job.depth;
+            logic.set_limits(think_time_ms, job.node_limit);
+            current.line = logic.find_best_turns(job.pos, job.color);
+            current.nodes = logic.nodes();
+            queued.result.set_value(move(current));
+        }
+    }
+
+    Config config; // Настройки бота для Logic всех потоков
+    TransTable table; // Общая таблица транспозиций
+    vector<job_queue> queues; // Очереди заданий потоков
+    vector<thread> workers;
+    atomic<uint64_t> next_seq{ 0 }; // Номер следующего задания
+    atomic<uint64_t> started{ 0 }; // Число начатых заданий
+    atomic<size_t> pending{ 0 }; // Число заданий в очередях
+    mutex wake_mtx;
+    condition_variable wake_cv; // Ожидание заданий
+    bool quit = false;
+};
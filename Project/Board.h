@@ -3,6 +3,7 @@
 #include <fstream>
 #include <vector>
 
+#include "GameState.h"
 #include "Move.h"
 #include "Project_path.h"
 
@@ -16,13 +17,17 @@
 
 using namespace std;
 
+// Окно с доской: отображает состояние партии (GameState) и перерисовывается при каждом его изменении,
+// а также подсветку клеток и результат игры
 class Board
 {
 public:
-    Board() = default;
-    Board(const unsigned int W, const unsigned int H) : W(W), H(H)
+    Board(GameState* state, const unsigned int W, const unsigned int H) : W(W), H(H), state(state)
     {
+        state->subscribe([this]() { rerender(); });
     }
+    Board(const Board&) = delete;
+    Board& operator=(const Board&) = delete;
 
     // инициализация и отрисовка начального состояния доски
     int start_draw()
@@ -73,69 +78,23 @@ public:
             print_exception("IMG_LoadTexture can't load main textures from " + textures_path);
             return 1;
         }
-        // Получнение размеров рендера и создание начальной марицы доски
+        // Получнение размеров рендера и отрисовка начальной расстановки
         SDL_GetRendererOutputSize(ren, &W, &H);
-        make_start_mtx();
         rerender();
         return 0;
     }
-    // Перерисовки доски (сброс состояния)
+    // Сброс отображения перед новой партией (расстановку сбрасывает GameState::reset)
     void redraw()
     {
         game_results = -1;
-        history_mtx.clear();
-        history_beat_series.clear();
-        make_start_mtx();
         clear_active();
         clear_highlight();
     }
-    // Перемещние фигуры на доске
-    void move_piece(move_pos turn, const int beat_series = 0)
-    {
-        if (turn.xb != -1)
-        {
-            mtx[turn.xb][turn.yb] = 0;
-        }
-        move_piece(turn.x, turn.y, turn.x2, turn.y2, beat_series);
-    }
-    // Перемещение фгуры на доске (внутренняя реализация)
-    void move_piece(const POS_T i, const POS_T j, const POS_T i2, const POS_T j2, const int beat_series = 0)
-    {
-        if (mtx[i2][j2])
-        {
-            throw runtime_error("final position is not empty, can't move");
-        }
-        if (!mtx[i][j])
-        {
-            throw runtime_error("begin position is empty, can't move");
-        }
-        if ((mtx[i][j] == 1 && i2 == 0) || (mtx[i][j] == 2 && i2 == 7))
-            mtx[i][j] += 2;
-        mtx[i2][j2] = mtx[i][j];
-        drop_piece(i, j);
-        add_history(beat_series);
-    }
-    // Удаление фигуры с доски
-    void drop_piece(const POS_T i, const POS_T j)
-    {
-        mtx[i][j] = 0;
-        rerender();
-    }
-    // Превращение фигуры в королеву
-    void turn_into_queen(const POS_T i, const POS_T j)
-    {
-        if (mtx[i][j] == 0 || mtx[i][j] > 2)
-        {
-            throw runtime_error("can't turn into queen in this position");
-        }
-        mtx[i][j] += 2;
-        rerender();
-    }
 
-    // Получение текущего состояния доски
-    vector<vector<POS_T>> get_board() const
+    // Состояние партии, которое показывает окно
+    const GameState& get_state() const
     {
-        return mtx;
+        return *state;
     }
 
     // подсветка клеток
@@ -181,20 +140,6 @@ public:
         return is_highlighted_[x][y];
     }
 
-    // Откат последнего хода
-    void rollback()
-    {
-        auto beat_series = max(1, *(history_beat_series.rbegin()));
-        while (beat_series-- && history_mtx.size() > 1)
-        {
-            history_mtx.pop_back();
-            history_beat_series.pop_back();
-        }
-        mtx = *(history_mtx.rbegin());
-        clear_highlight();
-        clear_active();
-    }
-
     // Отображение результата игры
     void show_final(const int res)
     {
@@ -231,32 +176,12 @@ public:
     }
 
 private:
-    // Добавление текущего состояния доски в историю
-    void add_history(const int beat_series = 0)
-    {
-        history_mtx.push_back(mtx);
-        history_beat_series.push_back(beat_series);
-    }
-    // Создание начальной матрицы доски
-    void make_start_mtx()
-    {
-        for (POS_T i = 0; i < 8; ++i)
-        {
-            for (POS_T j = 0; j < 8; ++j)
-            {
-                mtx[i][j] = 0;
-                if (i < 3 && (i + j) % 2 == 1)
-                    mtx[i][j] = 2;
-                if (i > 4 && (i + j) % 2 == 1)
-                    mtx[i][j] = 1;
-            }
-        }
-        add_history();
-    }
-
     // перерисовка всех элементов на доске
     void rerender()
     {
+        if (ren == nullptr)
+            return; // Окно еще не создано
+        const auto& mtx = state->get_board();
         // Очистка рендера и отрисовка
         SDL_RenderClear(ren);
         SDL_RenderCopy(ren, board, NULL, NULL);
@@ -355,10 +280,9 @@ private:
 public:
     int W = 0;
     int H = 0;
-    // История состояний доски
-    vector<vector<vector<POS_T>>> history_mtx;
 
 private:
+    GameState* state; // Отображаемое состояние партии
     SDL_Window* win = nullptr;
     SDL_Renderer* ren = nullptr;
     // Текстуры для доски, фигур и кнопок
@@ -387,9 +311,4 @@ private:
     int game_results = -1;
     // Матрица подсвеченых клеток
     vector<vector<bool>> is_highlighted_ = vector<vector<bool>>(8, vector<bool>(8, 0));
-    // Матрица состояния доски
-    // 1 - Белая фигура, 2 - Черная фигура, 3 - Белая королева, 4 - Черная королева
-    vector<vector<POS_T>> mtx = vector<vector<POS_T>>(8, vector<POS_T>(8, 0));
-    // история серий взятий
-    vector<int> history_beat_series;
 };
@@ -0,0 +1,102 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+// Ход из дебютной книги. Ход задается ключом позиции после него (Position::node_key с очередью соперника),
+// поэтому серия взятий не требует отдельной записи и одинаковые по результату ходы не различаются
+struct book_move
+{
+    uint64_t result_key = 0; // Ключ позиции после хода
+    uint32_t weight = 0;     // Вес хода при случайном выборе
+};
+
+// Запись файла книги: ключ позиции (с очередью хода) и один из ходов
+struct book_record
+{
+    uint64_t key = 0;
+    uint64_t result_key = 0;
+    uint32_t weight = 0;
+    uint32_t reserved = 0;
+};
+
+// Заголовок файла книги
+struct book_header
+{
+    char magic[4] = { 'C', 'K', 'B', 'K' };
+    uint32_t reserved = 0;
+    uint64_t count = 0; // Число записей
+};
+
+// Дебютная книга: позиции и веса ходов в них, поиск по ключу позиции за O(1)
+class OpeningBook
+{
+public:
+    // Загрузка книги из файла, возвращает false, если файла нет или он поврежден
+    bool load(const string& path)
+    {
+        positions.clear();
+        ifstream fin(path, ios::binary);
+        book_header header;
+        if (!fin.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+            memcmp(header.magic, book_header().magic, 4) != 0)
+            return false;
+        // Число записей из заголовка сверяется с размером файла до выделения памяти под них
+        const streamoff records_begin = fin.tellg();
+        fin.seekg(0, ios::end);
+        const streamoff records_size = fin.tellg() - records_begin;
+        if (!fin || header.count != uint64_t(records_size) / sizeof(book_record) ||
+            uint64_t(records_size) % sizeof(book_record) != 0)
+            return false;
+        fin.seekg(records_begin);
+        vector<book_record> records(header.count);
+        if (!fin.read(reinterpret_cast<char*>(records.data()), streamsize(records.size() * sizeof(book_record))))
+            return false;
+        for (const book_record& record : records)
+            add(record.key, record.result_key, record.weight);
+        return true;
+    }
+
+    // Сохранение книги в файл
+    bool save(const string& path) const
+    {
+        vector<book_record> records;
+        for (const auto& [key, moves] : positions)
+        {
+            for (const book_move& move : moves)
+                records.push_back({ key, move.result_key, move.weight, 0 });
+        }
+        book_header header;
+        header.count = records.size();
+        ofstream fout(path, ios::binary);
+        fout.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        fout.write(reinterpret_cast<const char*>(records.data()), streamsize(records.size() * sizeof(book_record)));
+        return bool(fout);
+    }
+
+    void add(const uint64_t key, const uint64_t result_key, const uint32_t weight)
+    {
+        positions[key].push_back({ result_key, weight });
+    }
+
+    // Ходы позиции с ключом key (nullptr, если позиции нет в книге)
+    const vector<book_move>* find(const uint64_t key) const
+    {
+        const auto it = positions.find(key);
+        return (it == positions.end() ? nullptr : &it->second);
+    }
+
+    size_t size() const
+    {
+        return positions.size();
+    }
+
+private:
+    unordered_map<uint64_t, vector<book_move>> positions;
+};
@@ -1,7 +1,9 @@
 ﻿#pragma once
 #include <fstream>
+#include <string>
 #include <nlohmann/json.hpp>
 using json = nlohmann::json;
+using namespace std;
 
 #include "Project_path.h"
 
@@ -16,6 +18,11 @@ public:
     {
         reload();
     }
+
+    // Настройки, заданные без файла (для консольных утилит)
+    explicit Config(const json& values) : config(values)
+    {
+    }
     void reload()
     {
         std::ifstream fin(project_path + "settings.json");
@@ -30,6 +37,15 @@ public:
 
     }
 
+    // Значение настройки или значение по умолчанию, если в settings.json её нет
+    template <class T>
+    T operator()(const string& setting_dir, const string& setting_name, const T& default_value) const
+    {
+        if (!config.contains(setting_dir) || !config[setting_dir].contains(setting_name))
+            return default_value;
+        return config[setting_dir][setting_name].template get<T>();
+    }
+
 private:
 
     json config;
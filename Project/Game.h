@@ -1,17 +1,17 @@
 #pragma once
 #include <chrono>
-#include <thread>
 
 #include "Project_path.h"
 #include "Board.h"
 #include "Config.h"
+#include "GameState.h"
 #include "Hand.h"
-#include "Logic.h"
+#include "logic.h"
 
 class Game
 {
 public:
-    Game() : board(config("WindowSize", "Width"), config("WindowSize", "Hight")), hand(&board), logic(&board, &config)
+    Game() : board(&state, config("WindowSize", "Width"), config("WindowSize", "Hight")), hand(&board), logic(&state, &config)
     {
         ofstream fout(project_path + "log.txt", ios_base::trunc);
         fout.close();
@@ -26,8 +26,9 @@ public:
         // Если это режим replay, инициализируем логику, перезагружаем конфиг и перерисовываем доску
         if (is_replay)
         {
-            logic = Logic(&board, &config); // Инициализация логики
+            logic = Logic(&state, &config); // Инициализация логики
             config.reload(); // Перезагрузка конфигурации
+            state.reset(); // Начальная расстановка
             board.redraw(); // Перерисовка доски
         }
         else
@@ -59,8 +60,14 @@ public:
             // Если текущий игрок - человек (не бот)
             if (!config("Bot", string("Is") + string((turn_num % 2) ? "Black" : "White") + string("Bot")))
             {
+                // Пока игрок думает, бот-соперник ищет свой ответ в фоне
+                const string opponent = ((1 - turn_num % 2) ? "Black" : "White");
+                if (config("Bot", string("Is") + opponent + string("Bot")))
+                    logic.start_ponder(turn_num % 2, config("Bot", opponent + string("BotLevel")));
+
                 // Обрабатываем ход игрока
                 auto resp = player_turn(turn_num % 2);
+                logic.stop_ponder();
 
                 // Если игрок выбрал выход
                 if (resp == Response::QUIT)
@@ -79,23 +86,35 @@ public:
                 {
                     // Откатываем ход, если это возможно
                     if (config("Bot", string("Is") + string((1 - turn_num % 2) ? "Black" : "White") + string("Bot")) &&
-                        !beat_series && board.history_mtx.size() > 2)
+                        !beat_series && state.history_size() > 2)
                     {
-                        board.rollback(); // Откат хода
+                        state.rollback(); // Откат хода
                         --turn_num; // Корректируем счетчик ходов
                     }
                     if (!beat_series)
                         --turn_num;
 
-                    board.rollback(); // Откат хода
+                    state.rollback(); // Откат хода
+                    board.clear_highlight();
+                    board.clear_active();
                     --turn_num; // Корректируем счетчик ходов
                     beat_series = 0; // Сбрасываем счетчик серии взятий
                 }
             }
             else
             {
-                // Если текущий игрок - бот, выполняем его ход
-                bot_turn(turn_num % 2);
+                // Если текущий игрок - бот, выполняем его ход; окно при этом можно закрыть или начать игру заново
+                auto resp = bot_turn(turn_num % 2);
+                if (resp == Response::QUIT)
+                {
+                    is_quit = true;
+                    break;
+                }
+                else if (resp == Response::REPLAY)
+                {
+                    is_replay = true;
+                    break;
+                }
             }
         }
 
@@ -144,23 +163,25 @@ public:
     }
 
 private:
-    // Метод bot_turn отвечает за выполнение хода бота
-    void bot_turn(const bool color)
+    // Метод bot_turn отвечает за выполнение хода бота. Поиск идет в отдельном потоке, а главный поток
+    // обрабатывает события окна; при выходе или повторе игры поиск отменяется и возвращается QUIT / REPLAY
+    Response bot_turn(const bool color)
     {
         // Засекаем время начала хода для замера длительности
         auto start = chrono::steady_clock::now();
 
         // Получаем задержку для хода бота из конфигурации
-        auto delay_ms = config("Bot", "BotDelayMS");
+        const int delay_ms = config("Bot", "BotDelayMS");
 
-        // Создаем отдельный поток для задержки, чтобы она не влияла на поиск хода
-        thread th(SDL_Delay, delay_ms);
-
-        // Ищем лучшие ходы для бота
-        auto turns = logic.find_best_turns(color);
-
-        // Ожидаем завершения потока с задержкой
-        th.join();
+        // Ищем лучшие ходы для бота, ход показывается не раньше, чем через delay_ms
+        logic.start_search(color);
+        auto resp = wait_bot(start + chrono::milliseconds(delay_ms));
+        if (resp != Response::OK)
+        {
+            logic.cancel_search();
+            return resp;
+        }
+        auto turns = logic.search_result();
 
         bool is_first = true; // Флаг для первого хода в серии
 
@@ -170,15 +191,17 @@ private:
             // Если это не первый ход, добавляем задержку
             if (!is_first)
             {
-                SDL_Delay(delay_ms);
+                resp = wait_bot(chrono::steady_clock::now() + chrono::milliseconds(delay_ms));
+                if (resp != Response::OK)
+                    return resp;
             }
             is_first = false; // Сбрасываем флаг после первого хода
 
             // Увеличиваем счетчик серии взятий, если ход включает взятие фигуры
             beat_series += (turn.xb != -1);
 
-            // Выполняем ход на доске
-            board.move_piece(turn, beat_series);
+            // Выполняем ход, окно перерисуется по изменению состояния
+            state.move_piece(turn, beat_series);
         }
 
         // Засекаем время окончания хода
@@ -188,6 +211,20 @@ private:
         ofstream fout(project_path + "log.txt", ios_base::app);
         fout << "Bot turn time: " << (int)chrono::duration<double, milli>(end - start).count() << " millisec\n";
         fout.close();
+        return Response::OK;
+    }
+
+    // Ожидание окончания поиска хода бота и момента until с обработкой событий окна
+    Response wait_bot(const chrono::steady_clock::time_point until)
+    {
+        while (!logic.search_ready() || chrono::steady_clock::now() < until)
+        {
+            auto resp = hand.poll();
+            if (resp != Response::OK)
+                return resp;
+            SDL_Delay(1);
+        }
+        return Response::OK;
     }
 
     Response player_turn(const bool color)
@@ -272,7 +309,7 @@ private:
         board.clear_active();
 
         // Выполняем ход
-        board.move_piece(pos, pos.xb != -1); // Перемещаем фигуру
+        state.move_piece(pos, pos.xb != -1); // Перемещаем фигуру
         if (pos.xb == -1) // Если ход без взятия, завершаем ход
             return Response::OK;
 
@@ -320,7 +357,7 @@ private:
                 board.clear_highlight(); // Сбрасываем подсветку
                 board.clear_active(); // Сбрасываем активную клетку
                 beat_series += 1; // Увеличиваем счетчик серии взятий
-                board.move_piece(pos, beat_series); // Перемещаем фигуру
+                state.move_piece(pos, beat_series); // Перемещаем фигуру
                 break;
             }
         }
@@ -331,6 +368,7 @@ private:
 
 private:
     Config config;
+    GameState state; // Состояние партии; доска (окно) только отображает его
     Board board;
     Hand hand;
     Logic logic;
@@ -0,0 +1,140 @@
+#pragma once
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+#include <vector>
+
+#include "Move.h"
+
+using namespace std;
+
+// Состояние партии без отрисовки: расстановка фигур и история ходов для отката. Логика и утилиты
+// работают с ним без SDL, а окно (Board) подписывается на изменения и перерисовывает доску
+class GameState
+{
+public:
+    GameState()
+    {
+        reset();
+    }
+
+    // Подписка на изменения расстановки; подписчик вызывается после каждого изменения
+    void subscribe(function<void()> listener)
+    {
+        listeners.push_back(move(listener));
+    }
+
+    // Начальная расстановка и пустая история
+    void reset()
+    {
+        history_mtx.clear();
+        history_beat_series.clear();
+        make_start_mtx();
+        notify();
+    }
+
+    // Перемещние фигуры с удалением взятой
+    void move_piece(const move_pos turn, const int beat_series = 0)
+    {
+        if (turn.xb != -1)
+            mtx[turn.xb][turn.yb] = 0;
+        move_piece(turn.x, turn.y, turn.x2, turn.y2, beat_series);
+    }
+
+    // Перемещение фгуры (внутренняя реализация), пешка на последней горизонтали становится дамкой
+    void move_piece(const POS_T i, const POS_T j, const POS_T i2, const POS_T j2, const int beat_series = 0)
+    {
+        if (mtx[i2][j2])
+            throw runtime_error("final position is not empty, can't move");
+        if (!mtx[i][j])
+            throw runtime_error("begin position is empty, can't move");
+        if ((mtx[i][j] == 1 && i2 == 0) || (mtx[i][j] == 2 && i2 == 7))
+            mtx[i][j] += 2;
+        mtx[i2][j2] = mtx[i][j];
+        mtx[i][j] = 0;
+        add_history(beat_series);
+        notify();
+    }
+
+    // Удаление фигуры с доски
+    void drop_piece(const POS_T i, const POS_T j)
+    {
+        mtx[i][j] = 0;
+        notify();
+    }
+
+    // Превращение фигуры в королеву
+    void turn_into_queen(const POS_T i, const POS_T j)
+    {
+        if (mtx[i][j] == 0 || mtx[i][j] > 2)
+            throw runtime_error("can't turn into queen in this position");
+        mtx[i][j] += 2;
+        notify();
+    }
+
+    // Откат последнего хода вместе с его серией взятий
+    void rollback()
+    {
+        auto beat_series = max(1, *(history_beat_series.rbegin()));
+        while (beat_series-- && history_mtx.size() > 1)
+        {
+            history_mtx.pop_back();
+            history_beat_series.pop_back();
+        }
+        mtx = *(history_mtx.rbegin());
+        notify();
+    }
+
+    // Получение текущего состояния доски
+    // 1 - Белая фигура, 2 - Черная фигура, 3 - Белая королева, 4 - Черная королева
+    const vector<vector<POS_T>>& get_board() const
+    {
+        return mtx;
+    }
+
+    // Число сохраненных состояний (начальное и по одному на каждый полуход)
+    size_t history_size() const
+    {
+        return history_mtx.size();
+    }
+
+private:
+    // Добавление текущего состояния доски в историю
+    void add_history(const int beat_series = 0)
+    {
+        history_mtx.push_back(mtx);
+        history_beat_series.push_back(beat_series);
+    }
+
+    // Создание начальной матрицы доски
+    void make_start_mtx()
+    {
+        for (POS_T i = 0; i < 8; ++i)
+        {
+            for (POS_T j = 0; j < 8; ++j)
+            {
+                mtx[i][j] = 0;
+                if (i < 3 && (i + j) % 2 == 1)
+                    mtx[i][j] = 2;
+                if (i > 4 && (i + j) % 2 == 1)
+                    mtx[i][j] = 1;
+            }
+        }
+        add_history();
+    }
+
+    void notify() const
+    {
+        for (const auto& listener : listeners)
+            listener();
+    }
+
+    // Матрица состояния доски
+    vector<vector<POS_T>> mtx = vector<vector<POS_T>>(8, vector<POS_T>(8, 0));
+    // История состояний доски
+    vector<vector<vector<POS_T>>> history_mtx;
+    // история серий взятий
+    vector<int> history_beat_series;
+    // Подписчики на изменения
+    vector<function<void()>> listeners;
+};
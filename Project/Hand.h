@@ -42,7 +42,7 @@ public:
                     yc = int(x / (board->W / 10) - 1);
 
                     // Обработка специальных кнопок (например, "назад" и "повторить")
-                    if (xc == -1 && yc == -1 && board->history_mtx.size() > 1)
+                    if (xc == -1 && yc == -1 && board->get_state().history_size() > 1)
                     {
                         resp = Response::BACK; // Если нажата кнопка "назад"
                     }
@@ -79,6 +79,36 @@ public:
         return { resp, xc, yc };
     }
 
+    // Обработка накопившихся событий без ожидания, пока ходит бот: возвращает QUIT или REPLAY,
+    // если игрок закрыл окно или нажал "повторить", иначе OK (клики по доске и "назад" игнорируются)
+    Response poll() const
+    {
+        SDL_Event windowEvent; // Событие SDL
+        while (SDL_PollEvent(&windowEvent))
+        {
+            switch (windowEvent.type)
+            {
+            case SDL_QUIT: // Если событие - закрытие окна
+                return Response::QUIT;
+
+            case SDL_MOUSEBUTTONDOWN: // Если событие - нажатие кнопки мыши
+            {
+                int xc = int(windowEvent.motion.y / (board->H / 10) - 1);
+                int yc = int(windowEvent.motion.x / (board->W / 10) - 1);
+                if (xc == -1 && yc == 8)
+                    return Response::REPLAY; // Если нажата кнопка "повторить"
+            }
+            break;
+
+            case SDL_WINDOWEVENT: // Если событие - изменение размера окна
+                if (windowEvent.window.event == SDL_WINDOWEVENT_SIZE_CHANGED)
+                    board->reset_window_size();
+                break;
+            }
+        }
+        return Response::OK;
+    }
+
     // Метод для ожидания действия пользователя (например, нажатия кнопки)
     Response wait() const
     {
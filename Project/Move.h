@@ -10,10 +10,14 @@ struct move_pos
 {
     POS_T x, y;             // Координаты начальной позиции (откуда)
     POS_T x2, y2;           // Координаты конечной позиции (куда)
-    POS_T xb = -1, yb = -1; // Координаты позиции взятой фигуры (если есть)
+    POS_T xb, yb;           // Координаты позиции взятой фигуры (-1, если взятия нет)
+
+    // Конструктор по умолчанию не инициализирует поля, чтобы массивы ходов на стеке создавались бесплатно
+    move_pos() = default;
 
     // Конструктор для хода без взятия фигуры
-    move_pos(const POS_T x, const POS_T y, const POS_T x2, const POS_T y2) : x(x), y(y), x2(x2), y2(y2)
+    move_pos(const POS_T x, const POS_T y, const POS_T x2, const POS_T y2)
+        : x(x), y(y), x2(x2), y2(y2), xb(-1), yb(-1)
     {
     }
 
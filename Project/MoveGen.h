@@ -0,0 +1,294 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Move.h"
+#include "Position.h"
+
+using namespace std;
+
+// Емкость списка ходов. Дамка бьет не более чем в 4 направлениях с 6 полями приземления в каждом,
+// поэтому у 12 фигур не больше 288 взятий; тихих ходов не больше 12 * 13
+const int MAX_TURNS = 320;
+
+// Список ходов фиксированной емкости, размещается на стеке вызывающего
+struct MoveList
+{
+    move_pos moves[MAX_TURNS];
+    int count = 0;
+
+    void clear()
+    {
+        count = 0;
+    }
+
+    bool empty() const
+    {
+        return count == 0;
+    }
+
+    int size() const
+    {
+        return count;
+    }
+
+    void push_back(const move_pos& turn)
+    {
+        moves[count++] = turn;
+    }
+
+    move_pos& operator[](const int i)
+    {
+        return moves[i];
+    }
+
+    const move_pos& operator[](const int i) const
+    {
+        return moves[i];
+    }
+
+    move_pos* begin()
+    {
+        return moves;
+    }
+
+    move_pos* end()
+    {
+        return moves + count;
+    }
+
+    const move_pos* begin() const
+    {
+        return moves;
+    }
+
+    const move_pos* end() const
+    {
+        return moves + count;
+    }
+};
+
+// Направления по диагонали: (-1, -1), (-1, +1), (+1, -1), (+1, +1). Белые пешки ходят в направлениях 0 и 1,
+// черные - в направлениях 2 и 3
+const int DIRECTIONS = 4;
+constexpr POS_T dir_dx[DIRECTIONS] = { -1, -1, 1, 1 };
+constexpr POS_T dir_dy[DIRECTIONS] = { -1, 1, -1, 1 };
+
+// Таблицы переходов между тёмными полями, построенные на этапе компиляции
+struct move_tables
+{
+    int8_t neighbor[32][DIRECTIONS] = {}; // Соседнее поле по направлению (-1 - край доски)
+    int8_t jump[32][DIRECTIONS] = {};     // Поле приземления при взятии соседа пешкой (-1 - край доски)
+    int8_t ray[32][DIRECTIONS][7] = {};   // Все поля диагонали по направлению от ближнего к дальнему
+    int8_t ray_len[32][DIRECTIONS] = {};  // Число полей диагонали по направлению
+
+    constexpr move_tables()
+    {
+        for (int s = 0; s < 32; ++s)
+        {
+            for (int d = 0; d < DIRECTIONS; ++d)
+            {
+                int len = 0;
+                int x = square_x(s) + dir_dx[d], y = square_y(s) + dir_dy[d];
+                for (; x >= 0 && x < 8 && y >= 0 && y < 8; x += dir_dx[d], y += dir_dy[d])
+                    ray[s][d][len++] = int8_t(square(POS_T(x), POS_T(y)));
+                ray_len[s][d] = int8_t(len);
+                neighbor[s][d] = int8_t(len > 0 ? ray[s][d][0] : -1);
+                jump[s][d] = int8_t(len > 1 ? ray[s][d][1] : -1);
+            }
+        }
+    }
+};
+
+inline constexpr move_tables move_table{};
+
+// Ход между полями в координатах доски
+inline move_pos make_turn(const int from, const int to, const int captured = -1)
+{
+    if (captured == -1)
+        return move_pos(square_x(from), square_y(from), square_x(to), square_y(to));
+    return move_pos(square_x(from), square_y(from), square_x(to), square_y(to), square_x(captured),
+        square_y(captured));
+}
+
+// Добавление в список взятий фигуры с поля s
+inline void add_captures(const Position& pos, const int s, MoveList& list)
+{
+    const uint32_t bit = uint32_t(1) << s;
+    const uint32_t occupied = pos.occupied();
+    const uint32_t enemy = (pos.white & bit) ? pos.black : pos.white;
+    if (!(pos.kings & bit))
+    {
+        // Пешка бьет соседнюю фигуру соперника в любом направлении, если поле за ней свободно
+        for (int d = 0; d < DIRECTIONS; ++d)
+        {
+            const int to = move_table.jump[s][d];
+            if (to != -1 && ((enemy >> move_table.neighbor[s][d]) & 1) && !((occupied >> to) & 1))
+                list.push_back(make_turn(s, to, move_table.neighbor[s][d])); // Добавляем ход с взятием
+        }
+        return;
+    }
+    // Дамка бьет первую фигуру соперника на диагонали и встает на любое свободное поле за ней
+    for (int d = 0; d < DIRECTIONS; ++d)
+    {
+        const int8_t* ray = move_table.ray[s][d];
+        const int len = move_table.ray_len[s][d];
+        int k = 0;
+        while (k < len && !((occupied >> ray[k]) & 1))
+            ++k;
+        if (k >= len - 1 || !((enemy >> ray[k]) & 1))
+            continue; // Диагональ свободна до края, первая фигура своя или за ней край доски
+        const int captured = ray[k];
+        for (++k; k < len && !((occupied >> ray[k]) & 1); ++k)
+            list.push_back(make_turn(s, ray[k], captured)); // Добавляем ход с взятием
+    }
+}
+
+// Добавление в список ходов без взятия фигуры с поля s
+inline void add_quiet_turns(const Position& pos, const int s, MoveList& list)
+{
+    const uint32_t bit = uint32_t(1) << s;
+    const uint32_t occupied = pos.occupied();
+    if (!(pos.kings & bit))
+    {
+        // Пешка ходит на соседнее свободное поле вперед
+        const int first = (pos.white & bit) ? 0 : 2;
+        for (int d = first; d < first + 2; ++d)
+        {
+            const int to = move_table.neighbor[s][d];
+            if (to != -1 && !((occupied >> to) & 1))
+                list.push_back(make_turn(s, to)); // Добавляем обычный ход
+        }
+        return;
+    }
+    // Дамка ходит на любое свободное поле диагонали до первой фигуры
+    for (int d = 0; d < DIRECTIONS; ++d)
+    {
+        const int8_t* ray = move_table.ray[s][d];
+        const int len = move_table.ray_len[s][d];
+        for (int k = 0; k < len && !((occupied >> ray[k]) & 1); ++k)
+            list.push_back(make_turn(s, ray[k])); // Добавляем обычный ход
+    }
+}
+
+// Генерация ходов фигуры с клетки (x, y) в list: взятия, если они есть, иначе обычные ходы.
+// Возвращает true, если найдены взятия
+inline bool generate_turns(const Position& pos, const POS_T x, const POS_T y, MoveList& list)
+{
+    const int s = square(x, y);
+    list.clear();
+    add_captures(pos, s, list);
+    if (!list.empty())
+        return true;
+    add_quiet_turns(pos, s, list);
+    return false;
+}
+
+// Генерация всех ходов игрока color в list. Взятие обязательно: если хоть одна фигура может бить,
+// в список попадают только взятия. Возвращает true, если найдены взятия
+inline bool generate_turns(const Position& pos, const bool color, MoveList& list)
+{
+    list.clear();
+    // Перебираем фигуры текущего цвета в порядке возрастания номера поля
+    for (uint32_t own = pos.pieces(color); own; own &= own - 1)
+        add_captures(pos, lowest_bit(own), list);
+    if (!list.empty())
+        return true;
+    for (uint32_t own = pos.pieces(color); own; own &= own - 1)
+        add_quiet_turns(pos, lowest_bit(own), list);
+    return false;
+}
+
+// Сбор ходов в lines: одиночные ходы и все продолжения серий взятий до их конца. line - уже сделанная
+// часть серии, (x, y) - клетка фигуры, которая её продолжает (-1 - начало хода)
+inline void collect_lines(Position& pos, const bool color, const POS_T x, const POS_T y, vector<move_pos>& line,
+    vector<vector<move_pos>>& lines)
+{
+    MoveList list;
+    const bool beats = (x != -1 ? generate_turns(pos, x, y, list) : generate_turns(pos, color, list));
+    if (x != -1 && !beats)
+    {
+        lines.push_back(line); // Серия взятий закончилась
+        return;
+    }
+    for (const move_pos& turn : list)
+    {
+        line.push_back(turn);
+        if (beats)
+        {
+            const undo_info undo = pos.make_move(turn);
+            collect_lines(pos, color, turn.x2, turn.y2, line, lines);
+            pos.unmake_move(turn, undo);
+        }
+        else
+        {
+            lines.push_back(line);
+        }
+        line.pop_back();
+    }
+}
+
+// Все ходы игрока color целиком: одиночный ход или полная серия взятий, в порядке генератора
+inline vector<vector<move_pos>> generate_lines(Position pos, const bool color)
+{
+    vector<vector<move_pos>> lines;
+    vector<move_pos> line;
+    collect_lines(pos, color, -1, -1, line, lines);
+    return lines;
+}
+
+// Запись хода в виде "c3-d4" или серии взятий в виде "c3:e5:c7" (буква - столбец, цифра - строка доски)
+inline string line_to_string(const vector<move_pos>& line)
+{
+    auto cell = [](const POS_T x, const POS_T y) {
+        return string(1, char('a' + y)) + string(1, char('8' - x));
+    };
+    string res = cell(line[0].x, line[0].y);
+    for (const auto& turn : line)
+        res += (turn.xb != -1 ? ":" : "-") + cell(turn.x2, turn.y2);
+    return res;
+}
+
+// Разбор записи line_to_string в позиции pos с очередью color. Запись должна быть допустимым ходом
+// целиком: серия взятий - до конца, как её выдает поиск
+inline bool parse_line(Position pos, const bool color, const string& text, vector<move_pos>& line)
+{
+    line.clear();
+    if (text.size() < 5 || text.size() % 3 != 2)
+        return false;
+    POS_T x = -1, y = -1;
+    for (size_t i = 0; i + 2 < text.size(); i += 3)
+    {
+        const POS_T from_y = POS_T(text[i] - 'a'), from_x = POS_T('8' - text[i + 1]);
+        const POS_T to_y = POS_T(text[i + 3] - 'a'), to_x = POS_T('8' - text[i + 4]);
+        const bool capture = (text[i + 2] == ':');
+        if ((!capture && text[i + 2] != '-') || (x != -1 && (!capture || from_x != x || from_y != y)))
+            return false;
+        MoveList list;
+        const bool beats = (x != -1 ? generate_turns(pos, x, y, list) : generate_turns(pos, color, list));
+        if (beats != capture)
+            return false;
+        bool found = false;
+        for (const move_pos& turn : list)
+        {
+            if (turn.x == from_x && turn.y == from_y && turn.x2 == to_x && turn.y2 == to_y)
+            {
+                pos.make_move(turn);
+                line.push_back(turn);
+                found = true;
+                break;
+            }
+        }
+        if (!found)
+            return false;
+        x = to_x;
+        y = to_y;
+        if (!capture)
+            break;
+    }
+    if (int(line.size()) * 3 + 2 != int(text.size()))
+        return false;
+    MoveList rest;
+    return !(line.back().xb != -1 && generate_turns(pos, x, y, rest)); // Серия взятий не закончена
+}
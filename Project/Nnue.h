@@ -0,0 +1,274 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+// Набор инструкций для слоев сети выбирается при сборке: AVX2 (/arch:AVX2, -mavx2), SSSE3 (-mssse3),
+// SSE2 (любой x64) или переносимый скалярный код (он же при NNUE_FORCE_SCALAR)
+#if defined(NNUE_FORCE_SCALAR)
+#elif defined(__AVX2__)
+#include <immintrin.h>
+#define NNUE_AVX2
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#define NNUE_SSSE3
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define NNUE_SSE2
+#endif
+
+#include "Move.h"
+#include "Position.h"
+
+using namespace std;
+
+// Сеть NNUE: 128 входов (4 типа фигур на 32 полях с точки зрения одной из сторон) -> 128 нейронов
+// для каждой стороны (аккумулятор) -> 32 -> 1. Аккумулятор обновляется при каждом ходе разностью
+// строк первого слоя, поэтому полностью считаются только два маленьких последних слоя
+const int NNUE_INPUTS = 4 * 32; // Входы первого слоя
+const int NNUE_HIDDEN = 128; // Нейроны аккумулятора одной стороны
+const int NNUE_L2 = 32; // Нейроны второго слоя
+const int NNUE_QA = 127; // Масштаб активаций: 1.0 соответствует 127
+const int NNUE_QB = 64; // Масштаб весов второго и третьего слоев: 1.0 соответствует 64
+const int NNUE_OUTPUT_SCALE = 400; // Выход сети 1.0 соответствует оценке 400 (4 пешки)
+
+// Номер входа для фигуры type (в кодировке матрицы доски) на поле s с точки зрения стороны perspective.
+// Для черных доска поворачивается на 180 градусов и цвета фигур меняются местами, поэтому сеть
+// всегда видит позицию так, как её видят белые
+constexpr int nnue_feature(const int type, const int s, const bool perspective)
+{
+    return perspective ? ((type % 2 ? type + 1 : type - 1) - 1) * 32 + (31 - s) : (type - 1) * 32 + s;
+}
+
+// Заголовок файла сети
+struct nnue_header
+{
+    char magic[4] = { 'C', 'K', 'N', 'N' };
+    uint32_t inputs = NNUE_INPUTS;
+    uint32_t hidden = NNUE_HIDDEN;
+    uint32_t l2 = NNUE_L2;
+};
+
+// Квантованные веса сети
+struct NnueNetwork
+{
+    alignas(64) int16_t w1[NNUE_INPUTS][NNUE_HIDDEN] = {}; // Первый слой, общий для обеих сторон
+    alignas(64) int16_t b1[NNUE_HIDDEN] = {};
+    alignas(64) int8_t w2[NNUE_L2][2 * NNUE_HIDDEN] = {}; // Вход: сначала сторона, чей ход, затем соперник
+    int32_t b2[NNUE_L2] = {};
+    int8_t w3[NNUE_L2] = {};
+    int32_t b3 = 0;
+
+    // Загрузка сети из файла, возвращает false, если файла нет или размеры слоев не совпадают
+    bool load(const string& path)
+    {
+        ifstream fin(path, ios::binary);
+        nnue_header header;
+        const nnue_header expected;
+        if (!fin.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+            memcmp(&header, &expected, sizeof(header)) != 0)
+            return false;
+        return bool(read(fin, w1) && read(fin, b1) && read(fin, w2) && read(fin, b2) && read(fin, w3) &&
+            read(fin, b3));
+    }
+
+    bool save(const string& path) const
+    {
+        ofstream fout(path, ios::binary);
+        const nnue_header header;
+        fout.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        write(fout, w1);
+        write(fout, b1);
+        write(fout, w2);
+        write(fout, b2);
+        write(fout, w3);
+        write(fout, b3);
+        return bool(fout);
+    }
+
+private:
+    template <class T>
+    static bool read(ifstream& fin, T& data)
+    {
+        return bool(fin.read(reinterpret_cast<char*>(&data), sizeof(data)));
+    }
+
+    template <class T>
+    static void write(ofstream& fout, const T& data)
+    {
+        fout.write(reinterpret_cast<const char*>(&data), sizeof(data));
+    }
+};
+
+// Аккумулятор: выход первого слоя для каждой стороны ([0] - белые, [1] - черные)
+struct NnueAccumulator
+{
+    alignas(64) int16_t v[2][NNUE_HIDDEN];
+};
+
+// dst = src + add - sub1 - sub2 (sub2 может быть nullptr) для строк длины NNUE_HIDDEN
+inline void nnue_update_row(int16_t* dst, const int16_t* src, const int16_t* add, const int16_t* sub1,
+    const int16_t* sub2)
+{
+#if defined(NNUE_AVX2)
+    for (int i = 0; i < NNUE_HIDDEN; i += 16)
+    {
+        __m256i v = _mm256_load_si256(reinterpret_cast<const __m256i*>(src + i));
+        v = _mm256_add_epi16(v, _mm256_load_si256(reinterpret_cast<const __m256i*>(add + i)));
+        v = _mm256_sub_epi16(v, _mm256_load_si256(reinterpret_cast<const __m256i*>(sub1 + i)));
+        if (sub2)
+            v = _mm256_sub_epi16(v, _mm256_load_si256(reinterpret_cast<const __m256i*>(sub2 + i)));
+        _mm256_store_si256(reinterpret_cast<__m256i*>(dst + i), v);
+    }
+#elif defined(NNUE_SSSE3) || defined(NNUE_SSE2)
+    for (int i = 0; i < NNUE_HIDDEN; i += 8)
+    {
+        __m128i v = _mm_load_si128(reinterpret_cast<const __m128i*>(src + i));
+        v = _mm_add_epi16(v, _mm_load_si128(reinterpret_cast<const __m128i*>(add + i)));
+        v = _mm_sub_epi16(v, _mm_load_si128(reinterpret_cast<const __m128i*>(sub1 + i)));
+        if (sub2)
+            v = _mm_sub_epi16(v, _mm_load_si128(reinterpret_cast<const __m128i*>(sub2 + i)));
+        _mm_store_si128(reinterpret_cast<__m128i*>(dst + i), v);
+    }
+#else
+    for (int i = 0; i < NNUE_HIDDEN; ++i)
+        dst[i] = int16_t(src[i] + add[i] - sub1[i] - (sub2 ? sub2[i] : 0));
+#endif
+}
+
+// Активация аккумулятора: ограничение значений отрезком [0, 127] и упаковка в байты
+inline void nnue_activate(const int16_t* acc, uint8_t* out)
+{
+#if defined(NNUE_AVX2)
+    const __m256i max_value = _mm256_set1_epi16(NNUE_QA);
+    for (int i = 0; i < NNUE_HIDDEN; i += 32)
+    {
+        const __m256i a = _mm256_min_epi16(_mm256_load_si256(reinterpret_cast<const __m256i*>(acc + i)), max_value);
+        const __m256i b =
+            _mm256_min_epi16(_mm256_load_si256(reinterpret_cast<const __m256i*>(acc + i + 16)), max_value);
+        // packus упаковывает 128-битные половины по отдельности, перестановка восстанавливает порядок
+        const __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xD8);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(out + i), packed);
+    }
+#elif defined(NNUE_SSSE3) || defined(NNUE_SSE2)
+    const __m128i max_value = _mm_set1_epi16(NNUE_QA);
+    for (int i = 0; i < NNUE_HIDDEN; i += 16)
+    {
+        const __m128i a = _mm_min_epi16(_mm_load_si128(reinterpret_cast<const __m128i*>(acc + i)), max_value);
+        const __m128i b = _mm_min_epi16(_mm_load_si128(reinterpret_cast<const __m128i*>(acc + i + 8)), max_value);
+        _mm_store_si128(reinterpret_cast<__m128i*>(out + i), _mm_packus_epi16(a, b));
+    }
+#else
+    for (int i = 0; i < NNUE_HIDDEN; ++i)
+        out[i] = uint8_t(min(max(int(acc[i]), 0), NNUE_QA));
+#endif
+}
+
+// Скалярное произведение активаций (байты без знака) на веса int8 длины 2 * NNUE_HIDDEN
+inline int32_t nnue_dot(const uint8_t* input, const int8_t* weights)
+{
+#if defined(NNUE_AVX2)
+    const __m256i ones = _mm256_set1_epi16(1);
+    __m256i sum = _mm256_setzero_si256();
+    for (int i = 0; i < 2 * NNUE_HIDDEN; i += 32)
+    {
+        // Сумма пар произведений не превосходит 2 * 127 * 127 и помещается в int16 без насыщения
+        const __m256i products = _mm256_maddubs_epi16(_mm256_load_si256(reinterpret_cast<const __m256i*>(input + i)),
+            _mm256_load_si256(reinterpret_cast<const __m256i*>(weights + i)));
+        sum = _mm256_add_epi32(sum, _mm256_madd_epi16(products, ones));
+    }
+    __m128i sum128 = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    sum128 = _mm_add_epi32(sum128, _mm_shuffle_epi32(sum128, 0x4E));
+    sum128 = _mm_add_epi32(sum128, _mm_shuffle_epi32(sum128, 0xB1));
+    return _mm_cvtsi128_si32(sum128);
+#elif defined(NNUE_SSSE3) || defined(NNUE_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    __m128i sum = zero;
+    for (int i = 0; i < 2 * NNUE_HIDDEN; i += 16)
+    {
+        const __m128i in = _mm_load_si128(reinterpret_cast<const __m128i*>(input + i));
+        const __m128i w = _mm_load_si128(reinterpret_cast<const __m128i*>(weights + i));
+#if defined(NNUE_SSSE3)
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_maddubs_epi16(in, w), _mm_set1_epi16(1)));
+#else
+        // Без SSSE3 байты расширяются до int16: активации нулями, веса знаком
+        const __m128i w_lo = _mm_srai_epi16(_mm_unpacklo_epi8(w, w), 8);
+        const __m128i w_hi = _mm_srai_epi16(_mm_unpackhi_epi8(w, w), 8);
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_unpacklo_epi8(in, zero), w_lo));
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_unpackhi_epi8(in, zero), w_hi));
+#endif
+    }
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+    return _mm_cvtsi128_si32(sum);
+#else
+    int32_t sum = 0;
+    for (int i = 0; i < 2 * NNUE_HIDDEN; ++i)
+        sum += int32_t(input[i]) * weights[i];
+    return sum;
+#endif
+}
+
+// Полный пересчет аккумулятора по позиции
+inline void nnue_refresh(const NnueNetwork& net, const Position& pos, NnueAccumulator& acc)
+{
+    for (int p = 0; p < 2; ++p)
+    {
+        memcpy(acc.v[p], net.b1, sizeof(net.b1));
+        for (uint32_t rest = pos.occupied(); rest; rest &= rest - 1)
+        {
+            const int s = lowest_bit(rest);
+            const int16_t* row = net.w1[nnue_feature(pos.get(s), s, p)];
+            for (int i = 0; i < NNUE_HIDDEN; ++i)
+                acc.v[p][i] = int16_t(acc.v[p][i] + row[i]);
+        }
+    }
+}
+
+// Аккумулятор позиции после хода turn по аккумулятору позиции до хода. pos - позиция уже после хода,
+// undo - результат make_move: фигура могла стать дамкой и могла быть взята фигура соперника
+inline void nnue_update(const NnueNetwork& net, const NnueAccumulator& parent, NnueAccumulator& child,
+    const Position& pos, const move_pos& turn, const undo_info& undo)
+{
+    const int from = square(turn.x, turn.y), to = square(turn.x2, turn.y2);
+    const int new_type = pos.get(to);
+    const int old_type = undo.moved;
+    for (int p = 0; p < 2; ++p)
+    {
+        const int16_t* captured =
+            (undo.captured ? net.w1[nnue_feature(undo.captured, square(turn.xb, turn.yb), p)] : nullptr);
+        nnue_update_row(child.v[p], parent.v[p], net.w1[nnue_feature(new_type, to, p)],
+            net.w1[nnue_feature(old_type, from, p)], captured);
+    }
+}
+
+// Оценка позиции сетью с точки зрения игрока color
+inline int nnue_evaluate(const NnueNetwork& net, const NnueAccumulator& acc, const bool color)
+{
+    alignas(64) uint8_t input[2 * NNUE_HIDDEN];
+    nnue_activate(acc.v[color], input);
+    nnue_activate(acc.v[!color], input + NNUE_HIDDEN);
+    int32_t out = net.b3;
+    for (int j = 0; j < NNUE_L2; ++j)
+    {
+        const int32_t z = (nnue_dot(input, net.w2[j]) + net.b2[j]) / NNUE_QB;
+        out += min(max(z, 0), NNUE_QA) * net.w3[j];
+    }
+    return int(int64_t(out) * NNUE_OUTPUT_SCALE / (NNUE_QA * NNUE_QB));
+}
+
+// Название используемого набора инструкций (для журнала и утилит)
+inline const char* nnue_simd_name()
+{
+#if defined(NNUE_AVX2)
+    return "AVX2";
+#elif defined(NNUE_SSSE3)
+    return "SSSE3";
+#elif defined(NNUE_SSE2)
+    return "SSE2";
+#else
+    return "scalar";
+#endif
+}
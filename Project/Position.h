@@ -0,0 +1,308 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include "Move.h"
+
+using namespace std;
+
+// Подсчет количества единичных битов в маске
+inline int popcount(uint32_t mask)
+{
+#ifdef _MSC_VER
+    return int(__popcnt(mask));
+#else
+    return __builtin_popcount(mask);
+#endif
+}
+
+// Индекс младшего единичного бита маски (маска не должна быть пустой)
+inline int lowest_bit(uint32_t mask)
+{
+#ifdef _MSC_VER
+    unsigned long idx;
+    _BitScanForward(&idx, mask);
+    return int(idx);
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+// Номер тёмного поля (0..31) по координатам клетки, поля нумеруются по строкам
+constexpr int square(const POS_T x, const POS_T y)
+{
+    return x * 4 + y / 2;
+}
+
+// Координаты клетки по номеру тёмного поля
+constexpr POS_T square_x(const int s)
+{
+    return POS_T(s / 4);
+}
+
+constexpr POS_T square_y(const int s)
+{
+    return POS_T(2 * (s % 4) + 1 - (s / 4) % 2);
+}
+
+// Шаг генератора splitmix64, используется для получения ключей Зобриста на этапе компиляции
+constexpr uint64_t splitmix64(uint64_t& state)
+{
+    uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+// Случайные ключи Зобриста для хеширования позиций
+struct zobrist_keys
+{
+    uint64_t piece[5][32] = {}; // [тип фигуры в кодировке матрицы доски][поле]
+    uint64_t side = 0;          // Ход черных
+    uint64_t forced[32] = {};   // Поле фигуры, продолжающей серию взятий
+
+    constexpr zobrist_keys()
+    {
+        uint64_t state = 0x2545F4914F6CDD1Dull;
+        for (int t = 1; t < 5; ++t)
+        {
+            for (int s = 0; s < 32; ++s)
+                piece[t][s] = splitmix64(state);
+        }
+        side = splitmix64(state);
+        for (int s = 0; s < 32; ++s)
+            forced[s] = splitmix64(state);
+    }
+};
+
+inline constexpr zobrist_keys zobrist{};
+
+// Информация для отмены хода: тип походившей фигуры, взятая фигура и факт превращения в дамку
+struct undo_info
+{
+    POS_T moved = 0;       // Тип походившей фигуры до хода
+    POS_T captured = 0;    // Тип взятой фигуры (0 - ход без взятия)
+    bool promoted = false; // Пешка превратилась в дамку этим ходом
+    uint64_t key = 0;      // Ключ Зобриста до хода
+};
+
+// Битовое представление позиции: играть можно только на 32 тёмных полях,
+// поэтому каждое множество фигур хранится в одной 32-битной маске
+struct Position
+{
+    uint32_t white = 0; // Белые фигуры (пешки и дамки)
+    uint32_t black = 0; // Черные фигуры (пешки и дамки)
+    uint32_t kings = 0; // Дамки обоих цветов
+    uint64_t key = 0;   // Ключ Зобриста расстановки фигур, обновляется при каждом изменении
+    int count[5] = {};  // Число фигур каждого типа в кодировке матрицы доски (count[0] не используется)
+    int potential[2] = {}; // Сумма продвижения пешек к полю превращения: [0] - белых, [1] - черных
+
+    Position() = default;
+
+    // Построение позиции по матрице доски (1 - белая пешка, 2 - черная, 3 - белая дамка, 4 - черная дамка)
+    explicit Position(const vector<vector<POS_T>>& mtx)
+    {
+        for (POS_T i = 0; i < 8; ++i)
+        {
+            for (POS_T j = 0; j < 8; ++j)
+            {
+                if (mtx[i][j])
+                    set(i, j, mtx[i][j]);
+            }
+        }
+    }
+
+    // Построение позиции по маскам фигур
+    Position(const uint32_t white_mask, const uint32_t black_mask, const uint32_t kings_mask)
+    {
+        for (uint32_t rest = white_mask | black_mask; rest; rest &= rest - 1)
+        {
+            const int s = lowest_bit(rest);
+            const uint32_t bit = uint32_t(1) << s;
+            set(s, POS_T(((black_mask & bit) ? 2 : 1) + ((kings_mask & bit) ? 2 : 0)));
+        }
+    }
+
+    // Начальная расстановка: черные пешки на строках 0-2, белые на строках 5-7
+    static Position start()
+    {
+        Position pos;
+        for (int s = 0; s < 12; ++s)
+            pos.set(s, 2);
+        for (int s = 20; s < 32; ++s)
+            pos.set(s, 1);
+        return pos;
+    }
+
+    // Обратное преобразование в матрицу доски
+    vector<vector<POS_T>> to_mtx() const
+    {
+        vector<vector<POS_T>> mtx(8, vector<POS_T>(8, 0));
+        for (int s = 0; s < 32; ++s)
+            mtx[square_x(s)][square_y(s)] = get(s);
+        return mtx;
+    }
+
+    // Текстовая запись позиции: 32 символа по номерам полей (по строкам доски, строки через '/'),
+    // '.' - пустое поле, 'w' / 'b' - белая / черная пешка, 'W' / 'B' - белая / черная дамка
+    string to_string() const
+    {
+        static const char symbols[] = ".wbWB";
+        string res;
+        for (int s = 0; s < 32; ++s)
+        {
+            if (s && s % 4 == 0)
+                res += '/';
+            res += symbols[get(s)];
+        }
+        return res;
+    }
+
+    // Разбор текстовой записи позиции, возвращает false при ошибке в записи
+    static bool from_string(const string& text, Position& pos)
+    {
+        static const string symbols = ".wbWB";
+        pos = Position();
+        int s = 0;
+        for (const char c : text)
+        {
+            if (c == '/')
+                continue;
+            const size_t type = symbols.find(c);
+            if (type == string::npos || s >= 32)
+                return false;
+            if (type)
+                pos.set(s, POS_T(type));
+            ++s;
+        }
+        return s == 32;
+    }
+
+    // Ключ узла поиска: расстановка, очередь хода и фигура, продолжающая серию взятий (-1, если её нет)
+    uint64_t node_key(const bool color, const int forced_square = -1) const
+    {
+        return key ^ (color ? zobrist.side : 0) ^ (forced_square != -1 ? zobrist.forced[forced_square] : 0);
+    }
+
+    // Фигуры заданного цвета (0 - белые, 1 - черные)
+    uint32_t pieces(const bool color) const
+    {
+        return color ? black : white;
+    }
+
+    uint32_t occupied() const
+    {
+        return white | black;
+    }
+
+    // Тип фигуры на поле в кодировке матрицы доски
+    POS_T get(const int s) const
+    {
+        const uint32_t bit = uint32_t(1) << s;
+        if (!((white | black) & bit))
+            return 0;
+        return POS_T(((black & bit) ? 2 : 1) + ((kings & bit) ? 2 : 0));
+    }
+
+    POS_T get(const POS_T x, const POS_T y) const
+    {
+        return get(square(x, y));
+    }
+
+    // Установка фигуры на поле (type в кодировке матрицы доски, 0 - очистка поля)
+    void set(const int s, const POS_T type)
+    {
+        const uint32_t bit = uint32_t(1) << s;
+        const POS_T old_type = get(s);
+        if (old_type)
+        {
+            key ^= zobrist.piece[old_type][s];
+            update_stats(old_type, s, -1);
+        }
+        white &= ~bit;
+        black &= ~bit;
+        kings &= ~bit;
+        if (!type)
+            return;
+        if (type % 2)
+            white |= bit;
+        else
+            black |= bit;
+        if (type > 2)
+            kings |= bit;
+        key ^= zobrist.piece[type][s];
+        update_stats(type, s, 1);
+    }
+
+    void set(const POS_T x, const POS_T y, const POS_T type)
+    {
+        set(square(x, y), type);
+    }
+
+    // Выполнение хода на месте, возвращает информацию для его отмены
+    undo_info make_move(const move_pos& turn)
+    {
+        undo_info undo;
+        undo.key = key;
+        const int from = square(turn.x, turn.y), to = square(turn.x2, turn.y2);
+        if (turn.xb != -1)
+        {
+            const int cap = square(turn.xb, turn.yb);
+            undo.captured = get(cap);
+            set(cap, 0); // Удаление взятой фигуры
+        }
+        const uint32_t from_bit = uint32_t(1) << from, to_bit = uint32_t(1) << to;
+        const POS_T type = get(from);
+        undo.moved = type;
+        uint32_t& own = (white & from_bit) ? white : black;
+        own ^= from_bit | to_bit; // Перемещение фигуры
+        if (kings & from_bit)
+        {
+            kings ^= from_bit | to_bit;
+        }
+        else if ((&own == &white && turn.x2 == 0) || (&own == &black && turn.x2 == 7))
+        {
+            kings |= to_bit; // Превращение пешки в дамку
+            undo.promoted = true;
+        }
+        const POS_T new_type = POS_T(undo.promoted ? type + 2 : type);
+        key ^= zobrist.piece[type][from] ^ zobrist.piece[new_type][to];
+        update_stats(type, from, -1);
+        update_stats(new_type, to, 1);
+        return undo;
+    }
+
+    // Отмена хода, выполненного make_move
+    void unmake_move(const move_pos& turn, const undo_info& undo)
+    {
+        const int from = square(turn.x, turn.y), to = square(turn.x2, turn.y2);
+        const uint32_t from_bit = uint32_t(1) << from, to_bit = uint32_t(1) << to;
+        update_stats(get(to), to, -1);
+        update_stats(undo.moved, from, 1);
+        uint32_t& own = (white & to_bit) ? white : black;
+        own ^= from_bit | to_bit; // Возврат фигуры на исходное поле
+        if (undo.promoted)
+            kings &= ~to_bit;
+        else if (kings & to_bit)
+            kings ^= from_bit | to_bit;
+        if (undo.captured)
+            set(turn.xb, turn.yb, undo.captured); // Восстановление взятой фигуры
+        key = undo.key;
+    }
+
+private:
+    // Учет фигуры type на поле s в счетчиках материала и продвижения (sign = 1 - добавление, -1 - удаление)
+    void update_stats(const POS_T type, const int s, const int sign)
+    {
+        count[type] += sign;
+        if (type == 1)
+            potential[0] += sign * (7 - square_x(s)); // Белая пешка идет к строке 0
+        else if (type == 2)
+            potential[1] += sign * square_x(s); // Черная пешка идет к строке 7
+    }
+};
@@ -0,0 +1,412 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstring>
+
+#include "Move.h"
+#include "MoveGen.h"
+#include "Nnue.h"
+#include "Position.h"
+#include "Tablebase.h"
+#include "TransTable.h"
+
+using namespace std;
+
+const int INF = 1e9; // Определение бесконечности для оценки
+const int WIN_SCORE = 1000000; // Оценка выигранной позиции (уменьшается с числом ходов до выигрыша)
+const int MAX_PLY = 1000; // Граница числа ходов, в пределах которой оценка считается выигрышем
+const int TB_WIN_SCORE = WIN_SCORE - MAX_PLY / 2; // Выигрыш по эндшпильным таблицам (ниже найденного перебором,
+                                                  // уменьшается с числом ходов до конца партии из таблицы)
+const int MAN_SCORE = 100; // Стоимость пешки
+const int POTENTIAL_SCORE = 5; // Стоимость продвижения пешки на одну строку
+const int MAX_SEARCH_PLY = 128; // Число ходов от корня, для которых хранятся killer-ходы
+const int ASPIRATION_WINDOW = MAN_SCORE / 2; // Полуширина окна аспирации вокруг оценки прошлой итерации
+const int NNUE_STACK_SIZE = 256; // Наибольшее число ходов от корня, для которых хранятся аккумуляторы сети
+
+// Параметры поиска, известные на этапе компиляции. Режим оценки и уровень оптимизации из настроек
+// выбираются один раз при создании Logic, и в переборе нет ни сравнений строк, ни лишних ветвлений
+template <bool Potential, bool Pruning, bool Nnue = false>
+struct SearchPolicy
+{
+    static constexpr bool potential = Potential; // Учет продвижения пешек (режим "NumberAndPotential")
+    static constexpr bool pruning = Pruning; // Альфа-бета отсечения и таблица транспозиций (все уровни, кроме "O0")
+    static constexpr bool nnue = Nnue; // Оценка нейросетью вместо подсчета материала (Evaluator = "NNUE")
+};
+
+// Параметры оценки подсчетом материала. По умолчанию дамка стоит 5 пешек в режиме "NumberAndPotential"
+// и 4 в режиме "NumberOnly"; подобранные значения загружаются из файла, который пишет утилита TexelTune
+struct EvalParams
+{
+    int man = MAN_SCORE; // Стоимость пешки (единица оценки, при подборе не меняется)
+    int king = 5 * MAN_SCORE; // Стоимость дамки
+    int potential = POTENTIAL_SCORE; // Стоимость продвижения пешки на одну строку
+};
+
+// Состояние поиска, общее для всех потоков
+struct SearchShared
+{
+    EvalParams eval; // Параметры оценки
+    TransTable* tt = nullptr; // Таблица транспозиций (своя у Logic или общая для нескольких поисков)
+    atomic<bool> stopped{ false }; // Поиск прерван по времени
+    atomic<bool> aborted{ false }; // Поиск отменен извне (например, закончились раздумья в ход соперника)
+    chrono::steady_clock::time_point start; // Время начала поиска
+    int think_time_ms = 0; // Время на ход в миллисекундах (0 - без ограничения)
+    uint64_t node_limit = 0; // Ограничение числа узлов (0 - без ограничения)
+    atomic<uint64_t> node_count{ 0 }; // Узлы всех потоков с точностью до 1024 на поток (для node_limit)
+    atomic<int> depth{ 0 }; // Глубина текущей итерации основного потока
+    const Tablebase* tb = nullptr; // Эндшпильные таблицы (nullptr - не используются)
+    const NnueNetwork* nnue = nullptr; // Сеть оценки (nullptr - не используется)
+
+    // Время, прошедшее с начала поиска
+    double elapsed_ms() const
+    {
+        return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    }
+};
+
+// Поиск, выполняемый одним потоком: оценка и рекурсивный перебор.
+// Эвристики упорядочивания и счетчик узлов у каждого потока свои
+class SearchWorker
+{
+public:
+    explicit SearchWorker(SearchShared* shared) : shared(shared)
+    {
+    }
+
+    // Рекурсивный метод поиска (negamax с альфа-бета отсечением и таблицей транспозиций)
+    // depth - оставшееся число полуходов, оценка возвращается с точки зрения игрока color.
+    // Поиск с главным вариантом (PVS): первый ход узла ищется с полным окном, остальные - с нулевым
+    // окном (alpha, alpha + 1), и только ход, оказавшийся лучше alpha, перебирается повторно
+    template <class Policy>
+    int find_best_turns_rec(Position& pos, const bool color, const int depth, int alpha, int beta, const int ply,
+        const POS_T x = -1, const POS_T y = -1)
+    {
+        // Если время на ход истекло, результат узла уже не важен
+        if (check_stop())
+            return 0;
+
+        // Позиция из эндшпильных таблиц уже решена, перебирать её не нужно. Чем быстрее выигрыш, тем выше
+        // оценка, поэтому поиск выбирает ходы, приближающие конец партии
+        if (shared->tb && x == -1)
+        {
+            TbValue value;
+            int distance;
+            if (shared->tb->probe(pos, color, value, distance))
+            {
+                if (value == TbValue::WIN)
+                    return TB_WIN_SCORE - ply - distance;
+                if (value == TbValue::LOSS)
+                    return ply + distance - TB_WIN_SCORE;
+                return 0;
+            }
+        }
+
+        // Если достигнута максимальная глубина рекурсии, доигрываем взятия и оцениваем спокойную позицию
+        if (depth == 0)
+        {
+            return quiescence<Policy>(pos, color, alpha, beta, ply);
+        }
+
+        // Проверяем таблицу транспозиций
+        const int forced_square = (x != -1 ? square(x, y) : -1);
+        const uint64_t key = pos.node_key(color, forced_square);
+        uint16_t tt_move = 0;
+        if constexpr (Policy::pruning)
+        {
+            tt_entry entry;
+            if (shared->tt->probe(key, entry))
+                tt_move = entry.move;
+            if (entry.bound() != Bound::NONE && entry.depth >= depth)
+            {
+                const int tt_score = score_from_tt(entry.score, ply);
+                if (entry.bound() == Bound::EXACT || (entry.bound() == Bound::LOWER && tt_score >= beta) ||
+                    (entry.bound() == Bound::UPPER && tt_score <= alpha))
+                    return tt_score;
+            }
+        }
+
+        // Если указаны координаты фигуры, ищем ходы для неё, иначе для всех фигур текущего цвета.
+        // Ходы узла хранятся на стеке, поэтому рекурсия их не затирает
+        MoveList turns_now;
+        const bool have_beats_now =
+            (x != -1 ? generate_turns(pos, x, y, turns_now) : generate_turns(pos, color, turns_now));
+
+        // Если нет взятий и указаны координаты фигуры, переходим к следующему ходу
+        if (!have_beats_now && x != -1)
+        {
+            return -find_best_turns_rec<Policy>(pos, 1 - color, depth - 1, -beta, -alpha, ply + 1);
+        }
+
+        // Если нет возможных ходов, текущий игрок проиграл
+        if (turns_now.empty())
+            return ply - WIN_SCORE;
+
+        order_turns(turns_now, pos, color, ply, tt_move);
+
+        const int alpha_orig = alpha;
+        int best_score = -INF;
+        uint16_t best_move = 0;
+
+        // Перебираем все возможные ходы
+        for (int i = 0; i < turns_now.size(); ++i)
+        {
+            const move_pos turn = turns_now[i];
+            int score = 0;
+            const undo_info undo = make_move<Policy>(pos, turn); // Выполнение хода на месте
+            // Если нет взятий и не указаны координаты фигуры, ход переходит к сопернику
+            if (!have_beats_now && x == -1)
+            {
+                if (Policy::pruning && i > 0)
+                    score = -find_best_turns_rec<Policy>(pos, 1 - color, depth - 1, -alpha - 1, -alpha, ply + 1);
+                if (!Policy::pruning || i == 0 || (score > alpha && score < beta))
+                    score = -find_best_turns_rec<Policy>(pos, 1 - color, depth - 1, -beta, -alpha, ply + 1);
+            }
+            else // Иначе продолжаем серию взятий той же фигурой
+            {
+                if (Policy::pruning && i > 0)
+                    score = find_best_turns_rec<Policy>(pos, color, depth, alpha, alpha + 1, ply, turn.x2, turn.y2);
+                if (!Policy::pruning || i == 0 || (score > alpha && score < beta))
+                    score = find_best_turns_rec<Policy>(pos, color, depth, alpha, beta, ply, turn.x2, turn.y2);
+            }
+            unmake_move<Policy>(pos, turn, undo); // Отмена хода
+            if (shared->stopped.load(memory_order_relaxed))
+                return 0; // Прерванный поиск не сохраняется в таблице
+
+            if (score > best_score)
+            {
+                best_score = score;
+                best_move = encode_move(turn);
+            }
+            alpha = max(alpha, best_score);
+
+            // Если alpha больше или равна beta, прекращаем поиск (отсечение)
+            if (Policy::pruning && alpha >= beta)
+            {
+                update_cutoff_stats(turn, color, depth, ply);
+                break;
+            }
+        }
+
+        // Сохраняем результат в таблице транспозиций
+        if constexpr (Policy::pruning)
+        {
+            const Bound bound =
+                (best_score >= beta ? Bound::LOWER : (best_score <= alpha_orig ? Bound::UPPER : Bound::EXACT));
+            shared->tt->store(key, depth, bound, score_to_tt(best_score, ply), best_move);
+        }
+        return best_score;
+    }
+
+    // Поиск взятий на горизонте: в шашках бить обязательно, поэтому позиция с взятием не оценивается,
+    // пока серии взятий обеих сторон не закончатся. Перебираются только взятия, генератор тот же,
+    // что и в основном поиске; узел без взятий оценивается calc_score. Глубина не ограничивается:
+    // каждое взятие уменьшает число фигур
+    template <class Policy>
+    int quiescence(Position& pos, const bool color, int alpha, const int beta, const int ply,
+        const POS_T x = -1, const POS_T y = -1)
+    {
+        if (check_stop())
+            return 0;
+
+        MoveList captures;
+        const bool have_beats_now =
+            (x != -1 ? generate_turns(pos, x, y, captures) : generate_turns(pos, color, captures));
+        if (!have_beats_now)
+        {
+            if (x != -1)
+                return -quiescence<Policy>(pos, 1 - color, -beta, -alpha, ply + 1); // Серия закончилась
+            if (captures.empty())
+                return ply - WIN_SCORE; // Ходов нет - текущий игрок проиграл
+            return calc_score<Policy>(pos, color, ply);
+        }
+
+        int best_score = -INF;
+        for (const move_pos& turn : captures)
+        {
+            const undo_info undo = make_move<Policy>(pos, turn);
+            const int score = quiescence<Policy>(pos, color, alpha, beta, ply, turn.x2, turn.y2);
+            unmake_move<Policy>(pos, turn, undo);
+            if (shared->stopped.load(memory_order_relaxed))
+                return 0;
+            best_score = max(best_score, score);
+            alpha = max(alpha, best_score);
+            if (Policy::pruning && alpha >= beta)
+                break;
+        }
+        return best_score;
+    }
+
+    // Подготовка к поиску из позиции pos: аккумулятор сети считается заново (если сеть используется)
+    void set_root(const Position& pos)
+    {
+        nnue_ply = 0;
+        if (shared->nnue)
+            nnue_refresh(*shared->nnue, pos, nnue_stack[0]);
+    }
+
+    // Уменьшение накопленной истории, чтобы новые отсечения значили больше старых
+    void age_history()
+    {
+        for (auto& side : history)
+            for (auto& from : side)
+                for (int& h : from)
+                    h /= 2;
+        for (auto& k : killers)
+            k[0] = k[1] = 0;
+    }
+
+    // Сброс истории и killer-ходов перед новой партией
+    void clear_history()
+    {
+        memset(history, 0, sizeof(history));
+        memset(killers, 0, sizeof(killers));
+    }
+
+private:
+    // Проверка лимитов времени и узлов раз в 1024 узла; первая итерация всегда завершается, чтобы был ход.
+    // Отмененный извне поиск останавливается сразу, его результат не используется
+    bool check_stop()
+    {
+        if ((++nodes & 1023) == 0)
+        {
+            const uint64_t total = shared->node_count.fetch_add(1024, memory_order_relaxed) + 1024;
+            if (shared->depth > 0 && ((shared->think_time_ms > 0 && shared->elapsed_ms() >= shared->think_time_ms) ||
+                (shared->node_limit > 0 && total >= shared->node_limit)))
+                shared->stopped = true;
+        }
+        if (shared->aborted.load(memory_order_relaxed))
+            shared->stopped.store(true, memory_order_relaxed);
+        return shared->stopped.load(memory_order_relaxed);
+    }
+
+    // Выполнение и отмена хода в переборе; с оценкой сетью аккумулятор обновляется вместе с позицией
+    template <class Policy>
+    undo_info make_move(Position& pos, const move_pos& turn)
+    {
+        const undo_info undo = pos.make_move(turn);
+        if constexpr (Policy::nnue)
+        {
+            nnue_update(*shared->nnue, nnue_stack[nnue_ply], nnue_stack[nnue_ply + 1], pos, turn, undo);
+            ++nnue_ply;
+        }
+        return undo;
+    }
+
+    template <class Policy>
+    void unmake_move(Position& pos, const move_pos& turn, const undo_info& undo)
+    {
+        pos.unmake_move(turn, undo);
+        if constexpr (Policy::nnue)
+            --nnue_ply;
+    }
+
+    // Оценка хода для упорядочивания: ход из таблицы транспозиций, взятия (сначала дамок),
+    // killer-ходы текущего уровня, затем ходы по истории отсечений
+    int turn_order_score(const move_pos& turn, const Position& pos, const bool color, const int ply,
+        const uint16_t tt_move) const
+    {
+        const uint16_t code = encode_move(turn);
+        if (code == tt_move)
+            return 1 << 30;
+        if (turn.xb != -1)
+            return (1 << 29) + (pos.get(turn.xb, turn.yb) > 2 ? 1 : 0);
+        if (ply < MAX_SEARCH_PLY)
+        {
+            if (killers[ply][0] == code)
+                return (1 << 28) + 1;
+            if (killers[ply][1] == code)
+                return 1 << 28;
+        }
+        return history[color][square(turn.x, turn.y)][square(turn.x2, turn.y2)];
+    }
+
+    // Упорядочивание ходов узла вставками по убыванию оценки (ходов мало, порядок равных сохраняется)
+    void order_turns(MoveList& list, const Position& pos, const bool color, const int ply,
+        const uint16_t tt_move) const
+    {
+        int scores[MAX_TURNS];
+        for (int i = 0; i < list.size(); ++i)
+        {
+            const move_pos turn = list[i];
+            const int score = turn_order_score(turn, pos, color, ply, tt_move);
+            int j = i;
+            for (; j > 0 && scores[j - 1] < score; --j)
+            {
+                scores[j] = scores[j - 1];
+                list[j] = list[j - 1];
+            }
+            scores[j] = score;
+            list[j] = turn;
+        }
+    }
+
+    // Запоминание тихого хода, вызвавшего отсечение
+    void update_cutoff_stats(const move_pos& turn, const bool color, const int depth, const int ply)
+    {
+        if (turn.xb != -1)
+            return;
+        const uint16_t code = encode_move(turn);
+        if (ply < MAX_SEARCH_PLY && killers[ply][0] != code)
+        {
+            killers[ply][1] = killers[ply][0];
+            killers[ply][0] = code;
+        }
+        int& h = history[color][square(turn.x, turn.y)][square(turn.x2, turn.y2)];
+        h += depth * depth;
+        if (h > (1 << 20))
+            age_history();
+    }
+
+    // Метод для расчета оценки текущего состояния доски с точки зрения игрока color.
+    // Материал и продвижение пешек позиция поддерживает сама, поэтому оценка не перебирает поля;
+    // сеть оценивает позицию по аккумулятору, обновленному в make_move
+    template <class Policy>
+    int calc_score(const Position& pos, const bool color, const int ply) const
+    {
+        if (!pos.white)
+            return (color ? WIN_SCORE - ply : ply - WIN_SCORE); // Если белых фигур нет, выиграли черные
+        if (!pos.black)
+            return (color ? ply - WIN_SCORE : WIN_SCORE - ply); // Если черных фигур нет, выиграли белые
+        if constexpr (Policy::nnue)
+            return nnue_evaluate(*shared->nnue, nnue_stack[nnue_ply], color);
+        const EvalParams& params = shared->eval;
+        int w = pos.count[1] * params.man; // Белые пешки
+        int b = pos.count[2] * params.man; // Черные пешки
+        if constexpr (Policy::potential)
+        {
+            w += params.potential * pos.potential[0]; // Учет потенциала белых пешек
+            b += params.potential * pos.potential[1]; // Учет потенциала черных пешек
+        }
+        const int score = (w + pos.count[3] * params.king) - (b + pos.count[4] * params.king);
+        return (color ? -score : score); // Оценка с точки зрения игрока color
+    }
+
+    // Перевод оценки выигрыша в независимую от глубины узла форму для таблицы транспозиций и обратно
+    static int score_to_tt(const int score, const int ply)
+    {
+        if (score > WIN_SCORE - MAX_PLY)
+            return score + ply;
+        if (score < MAX_PLY - WIN_SCORE)
+            return score - ply;
+        return score;
+    }
+
+    static int score_from_tt(const int score, const int ply)
+    {
+        if (score > WIN_SCORE - MAX_PLY)
+            return score - ply;
+        if (score < MAX_PLY - WIN_SCORE)
+            return score + ply;
+        return score;
+    }
+
+public:
+    uint64_t nodes = 0; // Число просмотренных узлов
+
+private:
+    SearchShared* shared; // Общее состояние поиска
+    uint16_t killers[MAX_SEARCH_PLY][2] = {}; // Два последних тихих хода, вызвавших отсечение, для каждого уровня
+    int history[2][32][32] = {}; // История отсечений тихих ходов [цвет][откуда][куда]
+    NnueAccumulator nnue_stack[NNUE_STACK_SIZE]; // Аккумуляторы сети для позиций на пути от корня
+    int nnue_ply = 0; // Число ходов от корня, номер текущего аккумулятора
+};
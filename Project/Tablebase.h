@@ -0,0 +1,417 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "Position.h"
+
+using namespace std;
+
+// Эндшпильные таблицы: результат каждой позиции с небольшим числом фигур при ходе белых.
+// Позиция с ходом черных переворачивается (поле s переходит в 31 - s, цвета меняются местами)
+// и ищется в таблице того же вида. Таблица одного соотношения материала хранится в отдельном файле,
+// по байту на позицию: результат и число ходов до конца партии при лучшей игре обеих сторон (серия
+// взятий - один ход). Без числа ходов все выигрыши равноценны, и поиск не отличает реализацию
+// выигрыша от перестановки дамок на месте
+
+const int MAX_TB_PIECES = 8; // Наибольшее число фигур, для которого поддерживаются таблицы
+
+// Результат позиции для стороны, которая делает ход
+enum class TbValue : uint8_t
+{
+    DRAW = 0,   // Ничья (ни одна сторона не может форсировать выигрыш)
+    WIN = 1,    // Выигрыш
+    LOSS = 2,   // Проигрыш
+    INVALID = 3 // Невозможная позиция (пешка на поле превращения)
+};
+
+// Код позиции в таблице: 0 - ничья, TB_INVALID_CODE - невозможная позиция, иначе число ходов до конца
+// партии плюс один. Выигрыш всегда за нечетное число ходов (последний ход делает выигравший), проигрыш -
+// за четное
+const uint8_t TB_DRAW_CODE = 0;
+const uint8_t TB_INVALID_CODE = 255;
+const int TB_MAX_DISTANCE = 253; // Наибольшее число ходов до конца партии, которое помещается в код
+
+inline uint8_t tb_code(const int distance)
+{
+    return uint8_t(distance + 1);
+}
+
+inline TbValue tb_value(const uint8_t code)
+{
+    if (code == TB_DRAW_CODE)
+        return TbValue::DRAW;
+    if (code == TB_INVALID_CODE)
+        return TbValue::INVALID;
+    return (code % 2 == 0 ? TbValue::WIN : TbValue::LOSS);
+}
+
+// Число ходов до конца партии для выигрыша или проигрыша
+inline int tb_distance(const uint8_t code)
+{
+    return code - 1;
+}
+
+// Биномиальные коэффициенты C(n, k) для нумерации расстановок фигур
+struct tb_binomials
+{
+    uint64_t c[33][MAX_TB_PIECES + 1] = {};
+
+    constexpr tb_binomials()
+    {
+        for (int n = 0; n <= 32; ++n)
+        {
+            c[n][0] = 1;
+            for (int k = 1; k <= MAX_TB_PIECES && k <= n; ++k)
+                c[n][k] = c[n - 1][k - 1] + (k < n ? c[n - 1][k] : 0);
+        }
+    }
+};
+
+inline constexpr tb_binomials tb_binom{};
+
+// Отражение доски: поле s переходит в поле 31 - s (поворот на 180 градусов)
+inline uint32_t reverse_bits(uint32_t mask)
+{
+    mask = ((mask >> 1) & 0x55555555u) | ((mask & 0x55555555u) << 1);
+    mask = ((mask >> 2) & 0x33333333u) | ((mask & 0x33333333u) << 2);
+    mask = ((mask >> 4) & 0x0F0F0F0Fu) | ((mask & 0x0F0F0F0Fu) << 4);
+    mask = ((mask >> 8) & 0x00FF00FFu) | ((mask & 0x00FF00FFu) << 8);
+    return (mask >> 16) | (mask << 16);
+}
+
+// Номер r-го (с нуля) единичного бита маски
+inline int nth_bit(uint32_t mask, int r)
+{
+    for (; r > 0; --r)
+        mask &= mask - 1;
+    return lowest_bit(mask);
+}
+
+// Соотношение материала: число белых пешек и дамок, черных пешек и дамок (ход белых)
+struct tb_material
+{
+    int wm = 0, wk = 0, bm = 0, bk = 0;
+
+    tb_material() = default;
+    tb_material(const int wm, const int wk, const int bm, const int bk) : wm(wm), wk(wk), bm(bm), bk(bk)
+    {
+    }
+
+    tb_material(const uint32_t white, const uint32_t black, const uint32_t kings)
+        : wm(popcount(white & ~kings)), wk(popcount(white & kings)), bm(popcount(black & ~kings)),
+          bk(popcount(black & kings))
+    {
+    }
+
+    int total() const
+    {
+        return wm + wk + bm + bk;
+    }
+
+    // Тот же материал с точки зрения соперника
+    tb_material swapped() const
+    {
+        return tb_material(bm, bk, wm, wk);
+    }
+
+    bool operator==(const tb_material& other) const
+    {
+        return wm == other.wm && wk == other.wk && bm == other.bm && bk == other.bk;
+    }
+
+    // Номер соотношения для таблиц поиска
+    int id() const
+    {
+        const int base = MAX_TB_PIECES + 1;
+        return ((wm * base + wk) * base + bm) * base + bk;
+    }
+
+    // Число позиций в таблице: пешки и дамки каждого цвета расставляются по оставшимся свободным полям
+    uint64_t size() const
+    {
+        return tb_binom.c[32][wm] * tb_binom.c[32 - wm][wk] * tb_binom.c[32 - wm - wk][bm] *
+            tb_binom.c[32 - wm - wk - bm][bk];
+    }
+
+    string file_name() const
+    {
+        return to_string(wm) + to_string(wk) + to_string(bm) + to_string(bk) + ".tb";
+    }
+};
+
+const int TB_MATERIAL_COUNT = (MAX_TB_PIECES + 1) * (MAX_TB_PIECES + 1) * (MAX_TB_PIECES + 1) * (MAX_TB_PIECES + 1);
+
+// Номер группы фигур group среди свободных полей free_mask (комбинаторная система счисления)
+inline uint64_t tb_rank(const uint32_t group, const uint32_t free_mask)
+{
+    uint64_t rank = 0;
+    int i = 1;
+    for (uint32_t rest = group; rest; rest &= rest - 1, ++i)
+    {
+        const int s = lowest_bit(rest);
+        rank += tb_binom.c[popcount(free_mask & ((uint32_t(1) << s) - 1))][i];
+    }
+    return rank;
+}
+
+// Обратное преобразование: расстановка count фигур по номеру rank среди свободных полей
+inline uint32_t tb_unrank(uint64_t rank, const int count, const uint32_t free_mask)
+{
+    uint32_t group = 0;
+    int r = popcount(free_mask);
+    for (int i = count; i > 0; --i)
+    {
+        do
+            --r;
+        while (tb_binom.c[r][i] > rank);
+        rank -= tb_binom.c[r][i];
+        group |= uint32_t(1) << nth_bit(free_mask, r);
+    }
+    return group;
+}
+
+// Номер позиции с ходом белых в таблице её материала
+inline uint64_t tb_index(const uint32_t white, const uint32_t black, const uint32_t kings, const tb_material& mat)
+{
+    uint32_t free_mask = ~uint32_t(0);
+    const uint32_t groups[4] = { white & ~kings, white & kings, black & ~kings, black & kings };
+    const int counts[4] = { mat.wm, mat.wk, mat.bm, mat.bk };
+    uint64_t index = 0;
+    for (int g = 0; g < 4; ++g)
+    {
+        index = index * tb_binom.c[popcount(free_mask)][counts[g]] + tb_rank(groups[g], free_mask);
+        free_mask &= ~groups[g];
+    }
+    return index;
+}
+
+// Позиция по номеру в таблице. Возвращает false для невозможной позиции
+inline bool tb_position(uint64_t index, const tb_material& mat, uint32_t& white, uint32_t& black, uint32_t& kings)
+{
+    const int counts[4] = { mat.wm, mat.wk, mat.bm, mat.bk };
+    uint64_t sizes[4];
+    int free_count = 32;
+    for (int g = 0; g < 4; ++g)
+    {
+        sizes[g] = tb_binom.c[free_count][counts[g]];
+        free_count -= counts[g];
+    }
+    uint64_t ranks[4];
+    for (int g = 3; g >= 0; --g)
+    {
+        ranks[g] = index % sizes[g];
+        index /= sizes[g];
+    }
+    uint32_t free_mask = ~uint32_t(0);
+    uint32_t groups[4];
+    for (int g = 0; g < 4; ++g)
+    {
+        groups[g] = tb_unrank(ranks[g], counts[g], free_mask);
+        free_mask &= ~groups[g];
+    }
+    white = groups[0] | groups[1];
+    black = groups[2] | groups[3];
+    kings = groups[1] | groups[3];
+    // Белая пешка не может стоять на строке 0, черная - на строке 7
+    return !(groups[0] & 0x0000000Fu) && !(groups[2] & 0xF0000000u);
+}
+
+// Заголовок файла таблицы
+struct tb_header
+{
+    char magic[4] = { 'C', 'K', 'T', 'D' };
+    uint8_t wm = 0, wk = 0, bm = 0, bk = 0; // Соотношение материала
+    uint64_t count = 0;                     // Число позиций
+};
+
+// Файл, отображенный в память только для чтения
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile()
+    {
+        close();
+    }
+
+    bool open(const string& path)
+    {
+        close();
+#ifdef _WIN32
+        file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+            FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+            return false;
+        LARGE_INTEGER file_size;
+        if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0)
+        {
+            close();
+            return false;
+        }
+        size = size_t(file_size.QuadPart);
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mapping)
+        {
+            close();
+            return false;
+        }
+        data = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+#else
+        fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0)
+        {
+            close();
+            return false;
+        }
+        size = size_t(st.st_size);
+        void* view = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        data = (view == MAP_FAILED ? nullptr : static_cast<const uint8_t*>(view));
+#endif
+        if (!data)
+        {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void close()
+    {
+#ifdef _WIN32
+        if (data)
+            UnmapViewOfFile(data);
+        if (mapping)
+            CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE)
+            CloseHandle(file);
+        mapping = nullptr;
+        file = INVALID_HANDLE_VALUE;
+#else
+        if (data)
+            munmap(const_cast<uint8_t*>(data), size);
+        if (fd >= 0)
+            ::close(fd);
+        fd = -1;
+#endif
+        data = nullptr;
+        size = 0;
+    }
+
+    const uint8_t* begin() const
+    {
+        return data;
+    }
+
+    size_t length() const
+    {
+        return size;
+    }
+
+private:
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#else
+    int fd = -1;
+#endif
+};
+
+// Набор эндшпильных таблиц, открытых через отображение файлов в память
+class Tablebase
+{
+public:
+    // Открытие всех таблиц до max_pieces фигур из каталога dir, возвращает число открытых файлов
+    int load(const string& dir, const int max_pieces)
+    {
+        files.clear();
+        tables.assign(TB_MATERIAL_COUNT, nullptr);
+        pieces = 0;
+        const int limit = min(max_pieces, MAX_TB_PIECES);
+        for (int wm = 0; wm <= limit; ++wm)
+            for (int wk = 0; wm + wk <= limit; ++wk)
+                for (int bm = 0; wm + wk + bm <= limit; ++bm)
+                    for (int bk = 0; wm + wk + bm + bk <= limit; ++bk)
+                    {
+                        const tb_material mat(wm, wk, bm, bk);
+                        if (wm + wk == 0 || bm + bk == 0)
+                            continue;
+                        auto file = make_unique<MappedFile>();
+                        if (!file->open(dir + "/" + mat.file_name()) || !valid(*file, mat))
+                            continue;
+                        tables[mat.id()] = file->begin() + sizeof(tb_header);
+                        pieces = max(pieces, mat.total());
+                        files.push_back(move(file));
+                    }
+        return int(files.size());
+    }
+
+    // Наибольшее число фигур среди открытых таблиц (0 - таблиц нет)
+    int max_pieces() const
+    {
+        return pieces;
+    }
+
+    // Результат позиции для игрока color, который делает ход, и число ходов до конца партии.
+    // Возвращает false, если таблицы нет
+    bool probe(const Position& pos, const bool color, TbValue& value, int& distance) const
+    {
+        if (popcount(pos.occupied()) > pieces || !pos.white || !pos.black)
+            return false;
+        uint32_t white = pos.white, black = pos.black, kings = pos.kings;
+        if (color)
+        {
+            // Ход черных: переворачиваем доску и меняем цвета
+            white = reverse_bits(pos.black);
+            black = reverse_bits(pos.white);
+            kings = reverse_bits(pos.kings);
+        }
+        const tb_material mat(white, black, kings);
+        const uint8_t* data = tables[mat.id()];
+        if (!data)
+            return false;
+        const uint8_t code = data[tb_index(white, black, kings, mat)];
+        value = tb_value(code);
+        distance = tb_distance(code);
+        return value != TbValue::INVALID;
+    }
+
+private:
+    static bool valid(const MappedFile& file, const tb_material& mat)
+    {
+        if (file.length() < sizeof(tb_header))
+            return false;
+        tb_header header;
+        memcpy(&header, file.begin(), sizeof(header));
+        return memcmp(header.magic, tb_header().magic, 4) == 0 && header.wm == mat.wm && header.wk == mat.wk &&
+            header.bm == mat.bm && header.bk == mat.bk && header.count == mat.size() &&
+            file.length() >= sizeof(tb_header) + header.count;
+    }
+
+    vector<unique_ptr<MappedFile>> files;
+    vector<const uint8_t*> tables; // Данные таблиц по номеру соотношения материала
+    int pieces = 0;
+};
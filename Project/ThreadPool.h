@@ -0,0 +1,87 @@
+#pragma once
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// Пул потоков для параллельного поиска. Задача запускается сразу на всех потоках пула,
+// вызывающий поток участвует в ней как поток с номером 0
+class ThreadPool
+{
+public:
+    explicit ThreadPool(const size_t threads)
+    {
+        for (size_t i = 1; i < threads; ++i)
+            workers.emplace_back([this, i] { worker_loop(i); });
+    }
+
+    ~ThreadPool()
+    {
+        {
+            lock_guard<mutex> lock(mtx);
+            quit = true;
+        }
+        start_cv.notify_all();
+        for (auto& th : workers)
+            th.join();
+    }
+
+    // Число потоков вместе с вызывающим
+    size_t size() const
+    {
+        return workers.size() + 1;
+    }
+
+    // Выполнение task(номер потока) на всех потоках и ожидание завершения
+    void run_on_all(const function<void(size_t)>& task)
+    {
+        {
+            lock_guard<mutex> lock(mtx);
+            current = &task;
+            running = workers.size();
+            ++epoch;
+        }
+        start_cv.notify_all();
+        task(0);
+        unique_lock<mutex> lock(mtx);
+        done_cv.wait(lock, [this] { return running == 0; });
+        current = nullptr;
+    }
+
+private:
+    // Цикл потока пула: ожидание новой задачи, выполнение, сообщение о завершении
+    void worker_loop(const size_t index)
+    {
+        size_t seen_epoch = 0;
+        while (true)
+        {
+            const function<void(size_t)>* task;
+            {
+                unique_lock<mutex> lock(mtx);
+                start_cv.wait(lock, [&] { return quit || epoch != seen_epoch; });
+                if (quit)
+                    return;
+                seen_epoch = epoch;
+                task = current;
+            }
+            (*task)(index);
+            {
+                lock_guard<mutex> lock(mtx);
+                if (--running == 0)
+                    done_cv.notify_one();
+            }
+        }
+    }
+
+    vector<thread> workers;
+    mutex mtx;
+    condition_variable start_cv; // Появилась новая задача или пул завершается
+    condition_variable done_cv;  // Все потоки пула закончили задачу
+    const function<void(size_t)>* current = nullptr;
+    size_t running = 0;    // Число потоков пула, еще выполняющих задачу
+    size_t epoch = 0;      // Номер последней запущенной задачи
+    bool quit = false;
+};
@@ -0,0 +1,195 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include "Move.h"
+#include "Position.h"
+
+using namespace std;
+
+// Тип оценки, сохраненной в таблице транспозиций
+enum class Bound : uint8_t
+{
+    NONE,  // Пустая запись
+    UPPER, // Оценка не больше сохраненной (все ходы оказались хуже alpha)
+    LOWER, // Оценка не меньше сохраненной (произошло отсечение по beta)
+    EXACT  // Точная оценка
+};
+
+// Упакованный ход для хранения в таблице: поле начала и поле конца хода
+inline uint16_t encode_move(const move_pos& turn)
+{
+    return uint16_t(0x8000 | (square(turn.x, turn.y) << 5) | square(turn.x2, turn.y2));
+}
+
+// Запись таблицы транспозиций в распакованном виде
+struct tt_entry
+{
+    uint64_t key = 0;        // Полный ключ узла для проверки совпадения
+    int32_t score = 0;       // Оценка узла
+    uint16_t move = 0;       // Лучший ход (0 - нет хода)
+    uint8_t depth = 0;       // Оставшаяся глубина, на которую получена оценка
+    uint8_t gen_bound = 0;   // Поколение поиска (старшие биты) и тип оценки (младшие 2 бита)
+
+    Bound bound() const
+    {
+        return Bound(gen_bound & 3);
+    }
+
+    // Упаковка всех полей, кроме ключа, в одно 64-битное слово
+    uint64_t pack() const
+    {
+        return uint64_t(uint32_t(score)) | (uint64_t(move) << 32) | (uint64_t(depth) << 48) |
+            (uint64_t(gen_bound) << 56);
+    }
+
+    static tt_entry unpack(const uint64_t key, const uint64_t data)
+    {
+        tt_entry entry;
+        entry.key = key;
+        entry.score = int32_t(uint32_t(data));
+        entry.move = uint16_t(data >> 32);
+        entry.depth = uint8_t(data >> 48);
+        entry.gen_bound = uint8_t(data >> 56);
+        return entry;
+    }
+};
+
+// Ячейка таблицы, 16 байт. Вместо ключа хранится key ^ data: если два потока одновременно
+// пишут в ячейку и слова оказались от разных записей, проверка ключа при чтении не пройдет
+struct tt_slot
+{
+    atomic<uint64_t> key_xor_data{ 0 };
+    atomic<uint64_t> data{ 0 };
+};
+
+// Корзина из четырех ячеек занимает ровно одну кеш-линию
+struct alignas(64) tt_bucket
+{
+    tt_slot slots[4];
+};
+
+// Таблица транспозиций фиксированного размера с заменой по глубине и поколению.
+// Таблица общая для потоков поиска и работает без блокировок
+class TransTable
+{
+public:
+    TransTable() = default;
+    explicit TransTable(const size_t size_mb)
+    {
+        resize(size_mb);
+    }
+
+    // Выделение памяти под таблицу: число корзин округляется вниз до степени двойки, 0 отключает таблицу
+    void resize(const size_t size_mb)
+    {
+        generation.store(0, memory_order_relaxed);
+        size_t count = 0;
+        if (size_mb != 0)
+        {
+            count = 1;
+            while (count * 2 * sizeof(tt_bucket) <= size_mb * 1024 * 1024)
+                count *= 2;
+        }
+        vector<tt_bucket>(count).swap(buckets);
+        mask = count ? count - 1 : 0;
+    }
+
+    void clear()
+    {
+        for (auto& bucket : buckets)
+        {
+            for (auto& slot : bucket.slots)
+            {
+                slot.key_xor_data.store(0, memory_order_relaxed);
+                slot.data.store(0, memory_order_relaxed);
+            }
+        }
+        generation.store(0, memory_order_relaxed);
+    }
+
+    // Начало нового поиска: старые записи становятся первыми кандидатами на замену.
+    // Если таблица общая для нескольких поисков, поколение меняет её владелец
+    void new_search()
+    {
+        generation.fetch_add(4, memory_order_relaxed);
+    }
+
+    // Поиск записи по ключу, копия записи возвращается в out
+    bool probe(const uint64_t key, tt_entry& out) const
+    {
+        out = tt_entry();
+        if (buckets.empty())
+            return false;
+        for (const tt_slot& slot : buckets[key & mask].slots)
+        {
+            const uint64_t data = slot.data.load(memory_order_relaxed);
+            if ((slot.key_xor_data.load(memory_order_relaxed) ^ data) == key)
+            {
+                out = tt_entry::unpack(key, data);
+                if (out.bound() != Bound::NONE)
+                    return true;
+            }
+        }
+        out = tt_entry();
+        return false;
+    }
+
+    // Сохранение результата поиска узла
+    void store(const uint64_t key, const int depth, const Bound bound, const int score, uint16_t move)
+    {
+        if (buckets.empty())
+            return;
+        tt_bucket& bucket = buckets[key & mask];
+        tt_slot* replace = &bucket.slots[0];
+        tt_entry replace_entry = read(*replace);
+        for (tt_slot& slot : bucket.slots)
+        {
+            const tt_entry entry = read(slot);
+            // Запись того же узла обновляется на месте, лучший ход сохраняется, если новый неизвестен
+            if (entry.key == key)
+            {
+                replace = &slot;
+                replace_entry = entry;
+                break;
+            }
+            // Иначе вытесняется запись прошлого поиска или с наименьшей глубиной
+            if (priority(entry) < priority(replace_entry))
+            {
+                replace = &slot;
+                replace_entry = entry;
+            }
+        }
+        if (!move && replace_entry.key == key)
+            move = replace_entry.move;
+
+        tt_entry entry;
+        entry.score = score;
+        entry.move = move;
+        entry.depth = uint8_t(depth);
+        entry.gen_bound = uint8_t(generation.load(memory_order_relaxed) | uint8_t(bound));
+        const uint64_t data = entry.pack();
+        replace->data.store(data, memory_order_relaxed);
+        replace->key_xor_data.store(key ^ data, memory_order_relaxed);
+    }
+
+private:
+    static tt_entry read(const tt_slot& slot)
+    {
+        const uint64_t data = slot.data.load(memory_order_relaxed);
+        return tt_entry::unpack(slot.key_xor_data.load(memory_order_relaxed) ^ data, data);
+    }
+
+    // Ценность записи при выборе кандидата на замену
+    int priority(const tt_entry& entry) const
+    {
+        if (entry.bound() == Bound::NONE)
+            return -1;
+        return entry.depth + ((entry.gen_bound & ~3) == generation.load(memory_order_relaxed) ? 256 : 0);
+    }
+
+    vector<tt_bucket> buckets;
+    size_t mask = 0;
+    atomic<uint8_t> generation{ 0 }; // Поколение поиска, кратно 4 (младшие биты записи - тип оценки)
+};
@@ -1,361 +1,608 @@
 #pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
 #include <random>
+#include <thread>
 #include <vector>
 
+#include "Book.h"
 #include "Move.h"
-#include "Board.h"
+#include "MoveGen.h"
+#include "Nnue.h"
+#include "Position.h"
+#include "SearchWorker.h"
+#include "Tablebase.h"
+#include "ThreadPool.h"
 #include "Config.h"
+#include "GameState.h"
 
-const int INF = 1e9; // Определение бесконечности для оценки
+// Итог завершенной итерации углубления (для вывода хода поиска)
+struct search_info
+{
+    int depth = 0; // Глубина итерации
+    int score = 0; // Оценка с точки зрения стороны, чей ход
+    uint64_t nodes = 0; // Узлы всех потоков с начала поиска
+    double time_ms = 0; // Время с начала поиска
+    vector<vector<move_pos>> pv; // Главный вариант: лучший ход и продолжение из таблицы транспозиций
+};
 
 class Logic
 {
 public:
-    // Конструктор класса Logic, инициализирует доску и конфигурацию, а также настраивает генератор случайных чисел
-    Logic(Board* board, Config* config) : board(board), config(config)
+    // Конструктор класса Logic, инициализирует состояние партии и конфигурацию, а также настраивает генератор
+    // случайных чисел. Утилиты без партии передают state = nullptr и ищут ходы в переданной позиции
+    Logic(const GameState* state, Config* config) : state(state), config(config), shared(make_unique<SearchShared>())
+    {
+        rand_eng = std::default_random_engine(!((*config)("Bot", "NoRandom"))
+                ? (*config)("Bot", "Seed", unsigned(time(0)))
+                : 0); // Инициализация генератора случайных чисел
+        const string scoring_mode = (*config)("Bot", "BotScoringType"); // Получение режима оценки ходов
+        const string optimization = (*config)("Bot", "Optimization"); // Получение параметров оптимизации
+        // Оценка нейросетью из файла NnuePath (файл строит утилита NnueTrain), без файла - подсчет материала
+        if ((*config)("Bot", "Evaluator", string("Classic")) == "NNUE")
+        {
+            network = make_unique<NnueNetwork>();
+            if (network->load((*config)("Bot", "NnuePath", string("nnue.bin"))))
+                shared->nnue = network.get();
+            else
+                network.reset();
+        }
+        // Параметры оценки подсчетом материала: значения по умолчанию режима или подобранные TexelTune
+        if (scoring_mode != "NumberAndPotential")
+            shared->eval.king = 4 * MAN_SCORE;
+        const string params_path = (*config)("Bot", "EvalParamsPath", string());
+        if (!params_path.empty())
+            load_eval_params(params_path, shared->eval);
+        search_fn = select_search(scoring_mode, optimization, shared->nnue != nullptr);
+        pruning = (optimization != "O0");
+        own_table = make_unique<TransTable>((*config)("Bot", "HashSizeMB", 64)); // Выделение таблицы транспозиций
+        shared->tt = own_table.get();
+        shared->think_time_ms = (*config)("Bot", "ThinkTimeMS", 0); // Ограничение времени на ход (0 - без ограничения)
+
+        // Эндшпильные таблицы из каталога TablebasePath (файлы строит утилита TbGen)
+        const string tb_path = (*config)("Bot", "TablebasePath", string());
+        if (!tb_path.empty())
+        {
+            tablebase = make_unique<Tablebase>();
+            if (tablebase->load(tb_path, MAX_TB_PIECES) > 0)
+                shared->tb = tablebase.get();
+        }
+
+        // Дебютная книга из файла BookPath (файл строит утилита BookGen)
+        const string book_path = (*config)("Bot", "BookPath", string());
+        if (!book_path.empty())
+        {
+            book = make_unique<OpeningBook>();
+            if (!book->load(book_path))
+                book.reset();
+        }
+
+        // Потоки поиска: у каждого свой SearchWorker, таблица транспозиций общая.
+        // Root - потоки делят между собой корневые ходы, LazySMP - все потоки ищут всю позицию
+        const int threads = max(1, (*config)("Bot", "Threads", 1));
+        lazy_smp = ((*config)("Bot", "ParallelMode", string("Root")) == "LazySMP");
+        pool = make_unique<ThreadPool>(threads);
+        for (int i = 0; i < threads; ++i)
+            workers.emplace_back(shared.get());
+    }
+
+    Logic(Logic&&) = default;
+    Logic& operator=(Logic&&) = default;
+
+    ~Logic()
     {
-        rand_eng = std::default_random_engine(
-            !((*config)("Bot", "NoRandom")) ? unsigned(time(0)) : 0); // Инициализация генератора случайных чисел
-        scoring_mode = (*config)("Bot", "BotScoringType"); // Получение режима оценки ходов
-        optimization = (*config)("Bot", "Optimization"); // Получение параметров оптимизации
+        cancel_search();
+        stop_ponder();
     }
 
     // Метод для поиска лучшего хода для текущего игрока
+    // Поиск итеративно углубляется до Max_depth; если задан ThinkTimeMS, он прекращается по истечении
+    // времени и возвращается результат последней завершенной итерации
     vector<move_pos> find_best_turns(const bool color)
     {
-        next_best_state.clear(); // Очистка предыдущих состояний
-        next_move.clear(); // Очистка предыдущих ходов
+        return find_best_turns(Position(state->get_board()), color);
+    }
 
-        find_first_best_turn(board->get_board(), color, -1, -1, 0); // Поиск лучшего хода
+    // Поиск лучшего хода в заданной позиции
+    vector<move_pos> find_best_turns(Position pos, const bool color)
+    {
+        if (own_table)
+            shared->tt->new_search(); // Записи прошлых поисков остаются, но вытесняются первыми
+        shared->start = chrono::steady_clock::now();
+        shared->stopped = false;
+        shared->node_count = 0;
+        for (auto& worker : workers)
+        {
+            worker.nodes = 0;
+            worker.age_history();
+        }
+        // Корневые ходы - полные серии взятий или одиночные ходы. Они перемешиваются один раз:
+        // при равных оценках выбирается случайный из них, а дальше порядок только уточняется
+        // лучшими ходами завершенных итераций
+        root_lines = generate_lines(pos, color);
 
-        int cur_state = 0;
         vector<move_pos> res;
-        do
+        if (root_lines.empty())
+            return res;
+        // Ход уже найден раздумьями, пока соперник думал над своим
+        if (!ponder_result.empty() && ponder_key == pos.node_key(color) && ponder_depth == Max_depth)
         {
-            res.push_back(next_move[cur_state]); // Добавление лучшего хода в результат
-            cur_state = next_best_state[cur_state]; // Переход к следующему состоянию
-        } while (cur_state != -1 && next_move[cur_state].x != -1); // Пока есть следующие ходы
+            res.swap(ponder_result);
+            return res;
+        }
+        // Позиция из дебютной книги: ход выбирается по весам без поиска
+        if (book && book_turn(pos, color, res))
+            return res;
+        shuffle(root_lines.begin(), root_lines.end(), rand_eng);
+        if (!lazy_smp || workers.size() == 1)
+            return iterative_deepening(pos, color);
+
+        // Lazy SMP: поток 0 ведет обычное итеративное углубление, вспомогательные потоки
+        // независимо ищут ту же позицию и делятся результатами через таблицу транспозиций
+        const auto start_lines = root_lines; // Поток 0 меняет порядок root_lines, помощники берут копию
+        pool->run_on_all([&](const size_t thread_index) {
+            if (thread_index == 0)
+            {
+                res = iterative_deepening(pos, color);
+                shared->stopped = true; // Остановка вспомогательных потоков
+            }
+            else
+            {
+                helper_search(pos, color, start_lines, thread_index);
+            }
+        });
         return res;
     }
 
 private:
-    // Метод для выполнения хода на доске
-    vector<vector<POS_T>> make_turn(vector<vector<POS_T>> mtx, move_pos turn) const
+    // Специализация рекурсивного поиска под режим оценки и уровень оптимизации
+    using search_fn_t = int (SearchWorker::*)(Position&, bool, int, int, int, int, POS_T, POS_T);
+
+    static search_fn_t select_search(const string& scoring_mode, const string& optimization, const bool nnue)
     {
-        if (turn.xb != -1)
-            mtx[turn.xb][turn.yb] = 0; // Удаление фигуры, если это взятие
-        if ((mtx[turn.x][turn.y] == 1 && turn.x2 == 0) || (mtx[turn.x][turn.y] == 2 && turn.x2 == 7))
-            mtx[turn.x][turn.y] += 2; // Превращение пешки в дамку
-        mtx[turn.x2][turn.y2] = mtx[turn.x][turn.y]; // Перемещение фигуры
-        mtx[turn.x][turn.y] = 0; // Очистка старой позиции
-        return mtx;
+        const bool potential = (scoring_mode == "NumberAndPotential");
+        const bool pruning = (optimization != "O0");
+        if (potential)
+            return pruning ? select_evaluator<true, true>(nnue) : select_evaluator<true, false>(nnue);
+        return pruning ? select_evaluator<false, true>(nnue) : select_evaluator<false, false>(nnue);
     }
 
-    // Метод для расчета оценки текущего состояния доски
-    double calc_score(const vector<vector<POS_T>>& mtx, const bool first_bot_color) const
+    template <bool Potential, bool Pruning>
+    static search_fn_t select_evaluator(const bool nnue)
     {
-        // color - кто является максимизирующим игроком
-        double w = 0, wq = 0, b = 0, bq = 0;
-        for (POS_T i = 0; i < 8; ++i)
-        {
-            for (POS_T j = 0; j < 8; ++j)
-            {
-                w += (mtx[i][j] == 1); // Подсчет белых пешек
-                wq += (mtx[i][j] == 3); // Подсчет белых дамок
-                b += (mtx[i][j] == 2); // Подсчет черных пешек
-                bq += (mtx[i][j] == 4); // Подсчет черных дамок
-                if (scoring_mode == "NumberAndPotential")
-                {
-                    w += 0.05 * (mtx[i][j] == 1) * (7 - i); // Учет потенциала белых пешек
-                    b += 0.05 * (mtx[i][j] == 2) * (i); // Учет потенциала черных пешек
-                }
-            }
-        }
-        if (!first_bot_color)
-        {
-            swap(b, w); // Обмен значений для противоположного цвета
-            swap(bq, wq);
-        }
-        if (w + wq == 0)
-            return INF; // Если белых фигур нет, возвращаем бесконечность
-        if (b + bq == 0)
-            return 0; // Если черных фигур нет, возвращаем 0
-        int q_coef = 4; // Коэффициент для дамок
-        if (scoring_mode == "NumberAndPotential")
-        {
-            q_coef = 5; // Изменение коэффициента для дамок
-        }
-        return (b + bq * q_coef) / (w + wq * q_coef); // Возвращаем оценку
+        return nnue ? &SearchWorker::find_best_turns_rec<SearchPolicy<Potential, Pruning, true>>
+                    : &SearchWorker::find_best_turns_rec<SearchPolicy<Potential, Pruning, false>>;
     }
 
-    // Рекурсивный метод для поиска лучшего хода
-    double find_first_best_turn(vector<vector<POS_T>> mtx, const bool color, const POS_T x, const POS_T y, size_t state,
-        double alpha = -1)
+    // Загрузка параметров оценки из JSON-файла ({"ManScore": .., "KingScore": .., "PotentialScore": ..}),
+    // отсутствующие в файле параметры не меняются
+    static bool load_eval_params(const string& path, EvalParams& params)
     {
-        next_best_state.push_back(-1); // Добавление нового состояния
-        next_move.emplace_back(-1, -1, -1, -1); // Добавление нового хода
-        double best_score = -1; // Инициализация лучшей оценки
-        if (state != 0)
-            find_turns(x, y, mtx); // Поиск возможных ходов
-        auto turns_now = turns; // Получение текущих ходов
-        bool have_beats_now = have_beats; // Проверка наличия взятий
-
-        if (!have_beats_now && state != 0)
-        {
-            return find_best_turns_rec(mtx, 1 - color, 0, alpha); // Рекурсивный поиск лучшего хода
-        }
+        ifstream fin(path);
+        const json values = json::parse(fin, nullptr, false);
+        if (!values.is_object())
+            return false;
+        params.man = values.value("ManScore", params.man);
+        params.king = values.value("KingScore", params.king);
+        params.potential = values.value("PotentialScore", params.potential);
+        return true;
+    }
 
-        vector<move_pos> best_moves; // Лучшие ходы
-        vector<int> best_states; // Лучшие состояния
+    // Наибольшая глубина итеративного углубления: с сетью она ограничена размером стека аккумуляторов
+    // (кроме ходов на эту глубину на пути могут быть серии взятий, а их не больше числа фигур)
+    int depth_limit() const
+    {
+        return (shared->nnue ? min(Max_depth, NNUE_STACK_SIZE - 32) : Max_depth);
+    }
 
-        for (auto turn : turns_now)
+    // Итеративное углубление основного потока, возвращает ход последней завершенной итерации.
+    // Каждая итерация после первой ищется с окном аспирации вокруг оценки предыдущей; если оценка
+    // вышла за окно, нарушенная граница снимается и итерация повторяется
+    vector<move_pos> iterative_deepening(const Position& pos, const bool color)
+    {
+        vector<move_pos> res;
+        int score = 0;
+        for (shared->depth = 0; shared->depth <= depth_limit(); ++shared->depth)
         {
-            size_t next_state = next_move.size();
-            double score;
-            if (have_beats_now)
-            {
-                score = find_first_best_turn(make_turn(mtx, turn), color, turn.x2, turn.y2, next_state, best_score); // Рекурсивный поиск с взятием
-            }
-            else
+            int alpha = -INF, beta = INF;
+            if (pruning && shared->depth > 0)
             {
-                score = find_best_turns_rec(make_turn(mtx, turn), 1 - color, 0, best_score); // Рекурсивный поиск без взятия
+                alpha = score - ASPIRATION_WINDOW;
+                beta = score + ASPIRATION_WINDOW;
             }
-            if (score > best_score)
+            // Поиск лучшего хода на текущую глубину
+            size_t best = 0;
+            while (true)
             {
-                best_score = score; // Обновление лучшей оценки
-                next_best_state[state] = (have_beats_now ? int(next_state) : -1); // Обновление лучшего состояния
-                next_move[state] = turn; // Обновление лучшего хода
+                best = (lazy_smp ? search_root_single(workers[0], root_lines, pos, color, shared->depth, alpha, beta, score)
+                                 : search_root(pos, color, alpha, beta, score));
+                if (shared->stopped || (score > alpha && score < beta))
+                    break;
+                if (score <= alpha)
+                    alpha = -INF;
+                else
+                    beta = INF;
             }
+            if (shared->stopped)
+                break; // Незавершенная итерация не используется
+
+            res = root_lines[best];
+            // Лучший ход итерации перебирается первым в следующей итерации
+            rotate(root_lines.begin(), root_lines.begin() + best, root_lines.begin() + best + 1);
+            if (on_iteration)
+                on_iteration({ shared->depth, score, nodes(), shared->elapsed_ms(), principal_variation(pos, color, res) });
+
+            // Следующая итерация обычно дольше всех предыдущих вместе, её не начинаем, если не успеем
+            if (shared->think_time_ms > 0 && shared->elapsed_ms() * 2 > shared->think_time_ms)
+                break;
         }
-        return best_score; // Возвращаем лучшую оценку
+        return res;
     }
 
-    // Рекурсивный метод для поиска лучшего хода с использованием алгоритма минимакс и альфа-бета отсечения
-    double find_best_turns_rec(vector<vector<POS_T>> mtx, const bool color, const size_t depth, double alpha = -1,
-        double beta = INF + 1, const POS_T x = -1, const POS_T y = -1)
+    // Вспомогательный поток Lazy SMP: собственное итеративное углубление с другим порядком корневых
+    // ходов, нечетные потоки начинают на одну глубину дальше, чтобы потоки реже искали одно и то же
+    void helper_search(const Position& pos, const bool color, vector<vector<move_pos>> lines,
+        const size_t thread_index)
     {
-        // Если достигнута максимальная глубина рекурсии, возвращаем оценку текущего состояния доски
-        if (depth == Max_depth)
+        rotate(lines.begin(), lines.begin() + thread_index % lines.size(), lines.end());
+        for (int depth = 1 + int(thread_index % 2); depth <= depth_limit(); ++depth)
         {
-            return calc_score(mtx, (depth % 2 == color));
+            int score = 0;
+            const size_t best = search_root_single(workers[thread_index], lines, pos, color, depth, -INF, INF, score);
+            if (shared->stopped)
+                return;
+            rotate(lines.begin(), lines.begin() + best, lines.begin() + best + 1);
         }
+    }
 
-        // Если указаны координаты фигуры, ищем возможные ходы для неё
-        if (x != -1)
-        {
-            find_turns(x, y, mtx);
-        }
-        else // Иначе ищем ходы для всех фигур текущего цвета
+    // Выбор хода из дебютной книги с вероятностью, пропорциональной весу.
+    // Возвращает false, если позиции нет в книге или ни один её ход не найден среди корневых
+    bool book_turn(const Position& pos, const bool color, vector<move_pos>& res)
+    {
+        const vector<book_move>* moves = book->find(pos.node_key(color));
+        if (!moves)
+            return false;
+        vector<size_t> candidates;
+        vector<uint32_t> weights;
+        for (size_t i = 0; i < root_lines.size(); ++i)
         {
-            find_turns(color, mtx);
+            Position next = pos;
+            for (const auto& turn : root_lines[i])
+                next.make_move(turn);
+            const uint64_t result_key = next.node_key(!color);
+            for (const book_move& move : *moves)
+            {
+                if (move.result_key == result_key && move.weight > 0)
+                {
+                    candidates.push_back(i);
+                    weights.push_back(move.weight);
+                    break;
+                }
+            }
         }
+        if (candidates.empty())
+            return false;
+        discrete_distribution<size_t> pick(weights.begin(), weights.end());
+        res = root_lines[candidates[pick(rand_eng)]];
+        return true;
+    }
 
-        auto turns_now = turns; // Сохраняем текущие ходы
-        bool have_beats_now = have_beats; // Сохраняем информацию о наличии взятий
-
-        // Если нет взятий и указаны координаты фигуры, переходим к следующему ходу
-        if (!have_beats_now && x != -1)
+    // Главный вариант: корневой ход и продолжение по лучшим ходам из таблицы транспозиций,
+    // пока они есть и позиция не повторяется
+    vector<vector<move_pos>> principal_variation(Position pos, bool color, const vector<move_pos>& first) const
+    {
+        vector<vector<move_pos>> pv{ first };
+        for (const auto& turn : first)
+            pos.make_move(turn);
+        color = !color;
+        vector<uint64_t> keys;
+        while (int(pv.size()) <= shared->depth)
         {
-            return find_best_turns_rec(mtx, 1 - color, depth + 1, alpha, beta);
+            vector<move_pos> line;
+            POS_T x = -1, y = -1;
+            while (true)
+            {
+                const uint64_t key = pos.node_key(color, x != -1 ? square(x, y) : -1);
+                tt_entry entry;
+                if (find(keys.begin(), keys.end(), key) != keys.end() || !shared->tt->probe(key, entry) || !entry.move)
+                    return pv;
+                keys.push_back(key);
+                MoveList list;
+                if (x != -1)
+                    generate_turns(pos, x, y, list);
+                else
+                    generate_turns(pos, color, list);
+                const move_pos* turn = nullptr;
+                for (const move_pos& candidate : list)
+                    if (encode_move(candidate) == entry.move)
+                        turn = &candidate;
+                if (turn == nullptr)
+                    return pv;
+                pos.make_move(*turn);
+                line.push_back(*turn);
+                x = turn->x2;
+                y = turn->y2;
+                MoveList rest;
+                if (turn->xb == -1 || !generate_turns(pos, x, y, rest))
+                    break; // Ход (или серия взятий) закончен
+            }
+            pv.push_back(line);
+            color = !color;
         }
+        return pv;
+    }
 
-        // Если нет возможных ходов, возвращаем оценку в зависимости от глубины
-        if (turns.empty())
-            return (depth % 2 ? 0 : INF);
+    // Оценка одного корневого хода на заданную глубину с окном (alpha, beta)
+    int search_line(SearchWorker& worker, Position& pos, const bool color, const vector<move_pos>& line,
+        const int depth, const int alpha, const int beta)
+    {
+        vector<undo_info> undo;
+        for (const auto& turn : line)
+            undo.push_back(pos.make_move(turn));
+        worker.set_root(pos);
+        const int score = -(worker.*search_fn)(pos, 1 - color, depth, -beta, -alpha, 1, -1, -1);
+        for (size_t i = line.size(); i-- > 0;)
+            pos.unmake_move(line[i], undo[i]);
+        return score;
+    }
 
-        double min_score = INF + 1; // Минимальная оценка для минимизирующего игрока
-        double max_score = -1; // Максимальная оценка для максимизирующего игрока
+    // Оценка корневого хода, не первого в списке: сначала нулевым окном проверяется, лучше ли он alpha,
+    // и только тогда ход ищется с полным окном
+    int search_line_pvs(SearchWorker& worker, Position& pos, const bool color, const vector<move_pos>& line,
+        const int depth, const int alpha, const int beta)
+    {
+        if (!pruning)
+            return search_line(worker, pos, color, line, depth, alpha, beta);
+        const int score = search_line(worker, pos, color, line, depth, alpha, alpha + 1);
+        if (score <= alpha || score >= beta || shared->stopped)
+            return score;
+        return search_line(worker, pos, color, line, depth, alpha, beta);
+    }
 
-        // Перебираем все возможные ходы
-        for (auto turn : turns_now)
-        {
-            double score = 0.0;
-            // Если нет взятий и не указаны координаты фигуры, рекурсивно ищем лучший ход
-            if (!have_beats_now && x == -1)
+    // Поиск лучшего корневого хода с окном (alpha, beta), возвращает его номер в root_lines, оценка - в score.
+    // Первый ход (лучший в прошлой итерации) считается одним потоком, чтобы получить границу alpha,
+    // остальные разбирают потоки пула, и каждый найденный лучший ход сразу сужает окно для всех
+    size_t search_root(const Position& pos, const bool color, const int alpha_orig, const int beta, int& score)
+    {
+        Position first_pos = pos;
+        int best_score = search_line(workers[0], first_pos, color, root_lines[0], shared->depth, alpha_orig, beta);
+        size_t best = 0;
+        score = best_score;
+        if (root_lines.size() == 1 || best_score >= beta)
+            return best;
+
+        atomic<size_t> next_line{ 1 };
+        atomic<int> alpha{ max(alpha_orig, best_score) };
+        mutex best_mtx;
+        pool->run_on_all([&](const size_t thread_index) {
+            Position thread_pos = pos;
+            for (size_t i = next_line++; i < root_lines.size() && alpha < beta; i = next_line++)
             {
-                score = find_best_turns_rec(make_turn(mtx, turn), 1 - color, depth + 1, alpha, beta);
+                const int line_score = search_line_pvs(workers[thread_index], thread_pos, color, root_lines[i],
+                    shared->depth, alpha, beta);
+                if (shared->stopped)
+                    return;
+                lock_guard<mutex> lock(best_mtx);
+                if (line_score > best_score)
+                {
+                    best_score = line_score; // Обновление лучшей оценки
+                    best = i; // Обновление лучшего хода
+                    alpha = max(alpha.load(), line_score);
+                }
             }
-            else // Иначе продолжаем поиск с текущими координатами
+        });
+        score = best_score;
+        return best;
+    }
+
+    // Поиск лучшего корневого хода одним потоком с окном (alpha, beta), возвращает его номер в lines,
+    // оценка - в score
+    size_t search_root_single(SearchWorker& worker, const vector<vector<move_pos>>& lines, Position pos,
+        const bool color, const int depth, int alpha, const int beta, int& score)
+    {
+        int best_score = -INF;
+        size_t best = 0;
+        for (size_t i = 0; i < lines.size(); ++i)
+        {
+            const int line_score = (i == 0 ? search_line(worker, pos, color, lines[i], depth, alpha, beta)
+                                           : search_line_pvs(worker, pos, color, lines[i], depth, alpha, beta));
+            if (shared->stopped)
+                break;
+            if (line_score > best_score)
             {
-                score = find_best_turns_rec(make_turn(mtx, turn), color, depth, alpha, beta, turn.x2, turn.y2);
+                best_score = line_score; // Обновление лучшей оценки
+                best = i; // Обновление лучшего хода
+                alpha = max(alpha, line_score);
+                if (alpha >= beta)
+                    break;
             }
+        }
+        score = best_score;
+        return best;
+    }
 
-            // Обновляем минимальную и максимальную оценки
-            min_score = min(min_score, score);
-            max_score = max(max_score, score);
+    // Раздумья в ход соперника: сначала ищется его лучший ответ, что заполняет таблицу транспозиций
+    // для всех его ходов, затем ход бота в позиции после предсказанного ответа. Законченный поиск
+    // сохраняется и возвращается find_best_turns сразу, если соперник ответил, как предсказано
+    void ponder(Position pos, const bool color)
+    {
+        const auto guess = find_best_turns(pos, color);
+        if (guess.empty() || shared->aborted)
+            return;
+        for (const auto& turn : guess)
+            pos.make_move(turn);
+        auto reply = find_best_turns(pos, !color);
+        if (shared->aborted)
+            return; // Поиск не завершен
+        ponder_key = pos.node_key(!color);
+        ponder_depth = Max_depth;
+        ponder_result = move(reply);
+    }
 
-            // Альфа-бета отсечение
-            if (depth % 2)
-                alpha = max(alpha, max_score); // Обновляем альфа для максимизирующего игрока
-            else
-                beta = min(beta, min_score); // Обновляем бета для минимизирующего игрока
+public:
+    // Запуск раздумий в фоновом потоке, пока игрок color выбирает ход; depth - уровень бота-соперника.
+    // Выключается настройкой Bot/Ponder
+    void start_ponder(const bool color, const int depth)
+    {
+        stop_ponder();
+        ponder_result.clear();
+        if (!(*config)("Bot", "Ponder", true))
+            return;
+        Max_depth = depth;
+        saved_think_time_ms = shared->think_time_ms;
+        shared->think_time_ms = 0; // Раздумья идут до хода соперника
+        shared->aborted = false;
+        ponder_thread = thread(&Logic::ponder, this, Position(state->get_board()), color);
+    }
 
-            // Если альфа больше или равна бета, прекращаем поиск (отсечение)
-            if (optimization != "O0" && alpha >= beta)
-                return (depth % 2 ? max_score + 1 : min_score - 1);
-        }
+    // Запуск поиска хода для игрока color в отдельном потоке, окно тем временем обрабатывает события
+    void start_search(const bool color)
+    {
+        start_search(Position(state->get_board()), color);
+    }
+
+    // Запуск поиска в заданной позиции в отдельном потоке
+    void start_search(const Position& pos, const bool color)
+    {
+        stop_ponder();
+        cancel_search();
+        shared->aborted = false;
+        search_future = async(launch::async, [this, pos, color]() {
+            return find_best_turns(pos, color);
+        });
+    }
+
+    // Досрочное окончание поиска, запущенного start_search, без ожидания (можно вызывать из другого
+    // потока): search_result вернет ход последней завершенной итерации
+    void stop_search()
+    {
+        shared->aborted = true;
+    }
+
+    // Поиск, запущенный start_search, закончен (или не запускался)
+    bool search_ready() const
+    {
+        return !search_future.valid() || search_future.wait_for(chrono::seconds(0)) == future_status::ready;
+    }
+
+    // Результат поиска, запущенного start_search (ожидает его окончания)
+    vector<move_pos> search_result()
+    {
+        if (!search_future.valid())
+            return vector<move_pos>();
+        auto res = search_future.get();
+        shared->aborted = false; // Сброс остановки stop_search
+        return res;
+    }
 
-        // Возвращаем оценку в зависимости от глубины
-        return (depth % 2 ? max_score : min_score);
+    // Отмена поиска, запущенного start_search: поток останавливается за несколько миллисекунд
+    void cancel_search()
+    {
+        if (!search_future.valid())
+            return;
+        shared->aborted = true;
+        search_future.wait();
+        search_future = future<vector<move_pos>>();
+        shared->aborted = false;
+    }
+
+    // Остановка раздумий, результат законченного поиска сохраняется
+    void stop_ponder()
+    {
+        if (!ponder_thread.joinable())
+            return;
+        shared->aborted = true;
+        ponder_thread.join();
+        shared->aborted = false;
+        shared->think_time_ms = saved_think_time_ms;
     }
 
     // Метод для поиска всех возможных ходов для текущего цвета
-public:
     void find_turns(const bool color)
     {
-        find_turns(color, board->get_board());
+        MoveList list;
+        have_beats = generate_turns(Position(state->get_board()), color, list);
+        turns.assign(list.begin(), list.end());
     }
 
     // Метод для поиска всех возможных ходов для конкретной фигуры
     void find_turns(const POS_T x, const POS_T y)
     {
-        find_turns(x, y, board->get_board());
+        MoveList list;
+        have_beats = generate_turns(Position(state->get_board()), x, y, list);
+        turns.assign(list.begin(), list.end());
     }
 
-    // Приватный метод для поиска всех возможных ходов для текущего цвета на заданной доске
-private:
-    void find_turns(const bool color, const vector<vector<POS_T>>& mtx)
+    // Подготовка к новой партии без пересоздания Logic (для утилит, играющих много партий подряд):
+    // раздумья останавливаются, таблица транспозиций и история отсечений очищаются, генератор
+    // случайных чисел получает новое зерно (с NoRandom - прежнее нулевое)
+    void new_game(const unsigned seed)
     {
-        vector<move_pos> res_turns; // Вектор для хранения всех возможных ходов
-        bool have_beats_before = false; // Флаг для проверки наличия взятий
-
-        // Перебираем все клетки доски
-        for (POS_T i = 0; i < 8; ++i)
-        {
-            for (POS_T j = 0; j < 8; ++j)
-            {
-                // Если клетка содержит фигуру противоположного цвета, ищем ходы для неё
-                if (mtx[i][j] && mtx[i][j] % 2 != color)
-                {
-                    find_turns(i, j, mtx);
-                    // Если найдены взятия, очищаем предыдущие ходы и обновляем флаг
-                    if (have_beats && !have_beats_before)
-                    {
-                        have_beats_before = true;
-                        res_turns.clear();
-                    }
-                    // Если есть взятия или их не было ранее, добавляем ходы в результат
-                    if ((have_beats_before && have_beats) || !have_beats_before)
-                    {
-                        res_turns.insert(res_turns.end(), turns.begin(), turns.end());
-                    }
-                }
-            }
-        }
-
-        turns = res_turns; // Сохраняем найденные ходы
-        shuffle(turns.begin(), turns.end(), rand_eng); // Перемешиваем ходы для случайности
-        have_beats = have_beats_before; // Обновляем флаг наличия взятий
+        stop_ponder();
+        ponder_result.clear();
+        if (own_table)
+            shared->tt->clear();
+        for (auto& worker : workers)
+            worker.clear_history();
+        rand_eng.seed(!((*config)("Bot", "NoRandom")) ? seed : 0);
     }
 
-    // Метод для поиска всех возможных ходов для конкретной фигуры на заданной доске
-    void find_turns(const POS_T x, const POS_T y, const vector<vector<POS_T>>& mtx)
+    // Поиск в общей таблице транспозиций вместо своей (несколько Logic в одном процессе). Своя таблица
+    // освобождается; общую не очищает new_game, а её поколение меняет владелец таблицы
+    void share_table(TransTable* table)
     {
-        turns.clear(); // Очищаем предыдущие ходы
-        have_beats = false; // Сбрасываем флаг наличия взятий
-        POS_T type = mtx[x][y]; // Тип фигуры
-
-        // Проверка на взятия
-        switch (type)
-        {
-        case 1:
-        case 2:
-            // Проверка для пешек
-            for (POS_T i = x - 2; i <= x + 2; i += 4)
-            {
-                for (POS_T j = y - 2; j <= y + 2; j += 4)
-                {
-                    if (i < 0 || i > 7 || j < 0 || j > 7)
-                        continue;
-                    POS_T xb = (x + i) / 2, yb = (y + j) / 2;
-                    if (mtx[i][j] || !mtx[xb][yb] || mtx[xb][yb] % 2 == type % 2)
-                        continue;
-                    turns.emplace_back(x, y, i, j, xb, yb); // Добавляем ход с взятием
-                }
-            }
-            break;
-        default:
-            // Проверка для дамок
-            for (POS_T i = -1; i <= 1; i += 2)
-            {
-                for (POS_T j = -1; j <= 1; j += 2)
-                {
-                    POS_T xb = -1, yb = -1;
-                    for (POS_T i2 = x + i, j2 = y + j; i2 != 8 && j2 != 8 && i2 != -1 && j2 != -1; i2 += i, j2 += j)
-                    {
-                        if (mtx[i2][j2])
-                        {
-                            if (mtx[i2][j2] % 2 == type % 2 || (mtx[i2][j2] % 2 != type % 2 && xb != -1))
-                            {
-                                break;
-                            }
-                            xb = i2;
-                            yb = j2;
-                        }
-                        if (xb != -1 && xb != i2)
-                        {
-                            turns.emplace_back(x, y, i2, j2, xb, yb); // Добавляем ход с взятием
-                        }
-                    }
-                }
-            }
-            break;
-        }
+        own_table.reset();
+        shared->tt = table;
+    }
 
-        // Если есть взятия, завершаем поиск
-        if (!turns.empty())
-        {
-            have_beats = true;
-            return;
-        }
+    // Ограничения поиска: время на ход и число узлов (0 - без ограничения)
+    void set_limits(const int think_time_ms, const uint64_t node_limit)
+    {
+        shared->think_time_ms = think_time_ms;
+        shared->node_limit = node_limit;
+    }
 
-        // Проверка на обычные ходы (без взятий)
-        switch (type)
-        {
-        case 1:
-        case 2:
-            // Проверка для пешек
-        {
-            POS_T i = ((type % 2) ? x - 1 : x + 1);
-            for (POS_T j = y - 1; j <= y + 1; j += 2)
-            {
-                if (i < 0 || i > 7 || j < 0 || j > 7 || mtx[i][j])
-                    continue;
-                turns.emplace_back(x, y, i, j); // Добавляем обычный ход
-            }
-            break;
-        }
-        default:
-            // Проверка для дамок
-            for (POS_T i = -1; i <= 1; i += 2)
-            {
-                for (POS_T j = -1; j <= 1; j += 2)
-                {
-                    for (POS_T i2 = x + i, j2 = y + j; i2 != 8 && j2 != 8 && i2 != -1 && j2 != -1; i2 += i, j2 += j)
-                    {
-                        if (mtx[i2][j2])
-                            break;
-                        turns.emplace_back(x, y, i2, j2); // Добавляем обычный ход
-                    }
-                }
-            }
-            break;
-        }
+    // Число узлов, просмотренных всеми потоками в последнем поиске
+    uint64_t nodes() const
+    {
+        uint64_t total = 0;
+        for (const auto& worker : workers)
+            total += worker.nodes;
+        return total;
     }
 
     // Публичные поля и методы
 public:
     vector<move_pos> turns; // Вектор для хранения возможных ходов
     bool have_beats; // Флаг наличия взятий
-    int Max_depth; // Максимальная глубина рекурсии
+    int Max_depth; // Максимальная глубина итеративного углубления
+    function<void(const search_info&)> on_iteration; // Вызывается после каждой завершенной итерации
 
     // Приватные поля
 private:
     default_random_engine rand_eng; // Генератор случайных чисел
-    string scoring_mode; // Режим оценки ходов
-    string optimization; // Параметры оптимизации
-    vector<move_pos> next_move; // Вектор для хранения следующего хода
-    vector<int> next_best_state; // Вектор для хранения следующего лучшего состояния
-    Board* board; // Указатель на доску
+    vector<vector<move_pos>> root_lines; // Корневые ходы (с сериями взятий) в порядке перебора
+    const GameState* state; // Указатель на состояние партии
     Config* config; // Указатель на конфигурацию
-};
\ No newline at end of file
+    unique_ptr<SearchShared> shared; // Общее состояние поиска
+    unique_ptr<TransTable> own_table; // Своя таблица транспозиций (нет, если задана общая)
+    unique_ptr<Tablebase> tablebase; // Эндшпильные таблицы
+    unique_ptr<OpeningBook> book; // Дебютная книга
+    unique_ptr<NnueNetwork> network; // Сеть оценки позиций
+    search_fn_t search_fn; // Рекурсивный поиск, выбранный по настройкам
+    unique_ptr<ThreadPool> pool; // Потоки параллельного поиска
+    bool lazy_smp = false; // Режим Lazy SMP вместо разделения корневых ходов
+    bool pruning = true; // Альфа-бета отсечения включены (окна аспирации и PVS имеют смысл только с ними)
+    vector<SearchWorker> workers; // Состояние поиска каждого потока
+    future<vector<move_pos>> search_future; // Поиск хода, запущенный start_search
+    thread ponder_thread; // Поток раздумий в ход соперника
+    vector<move_pos> ponder_result; // Ход, найденный раздумьями
+    uint64_t ponder_key = 0; // Ключ позиции, для которой найден ponder_result
+    int ponder_depth = 0; // Глубина, на которой найден ponder_result
+    int saved_think_time_ms = 0; // Ограничение времени, отключенное на время раздумий
+};
@@ -0,0 +1,123 @@
+// Анализ набора позиций сервисом AnalysisService: все позиции отправляются заданиями сразу, как от многих
+// одновременных партий, и ищутся на общем пуле потоков с общей таблицей транспозиций.
+// Использование: Analyse [позиции = positions.txt] [глубина = 10] [время на задание, мс = 0] [потоков]
+//                [хеш, МБ = 64] [копий = 1]
+//
+// Формат позиций - как у Bench ("позиция w|b", # - комментарий). Каждая позиция отправляется copies раз;
+// у первой копии приоритет выше, поэтому она выполняется раньше повторов. С ограничением времени срок
+// задания - момент отправки плюс это время. Результат печатается в JSON: ход, глубина, оценка и узлы
+// каждого задания, общее время и число заданий в секунду
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "AnalysisService.h"
+
+using namespace std;
+
+// Позиция набора
+struct analyse_position
+{
+    string text; // Запись Position::to_string
+    bool color;  // Очередь хода
+};
+
+vector<analyse_position> load_positions(const string& path)
+{
+    vector<analyse_position> res;
+    ifstream fin(path);
+    string line;
+    while (getline(fin, line))
+    {
+        istringstream in(line);
+        string text, side;
+        if (!(in >> text) || text[0] == '#')
+            continue;
+        in >> side;
+        res.push_back({ text, side == "b" });
+    }
+    return res;
+}
+
+int main(int argc, char** argv)
+{
+    const string positions_path = (argc > 1 ? argv[1] : "positions.txt");
+    const int depth = (argc > 2 ? atoi(argv[2]) : 10);
+    const int time_ms = (argc > 3 ? atoi(argv[3]) : 0);
+    const size_t threads = (argc > 4 ? size_t(max(1, atoi(argv[4]))) : max(1u, thread::hardware_concurrency()));
+    const size_t hash_mb = (argc > 5 ? size_t(max(0, atoi(argv[5]))) : 64);
+    const int copies = (argc > 6 ? max(1, atoi(argv[6])) : 1);
+
+    const auto positions = load_positions(positions_path);
+    if (positions.empty())
+    {
+        fprintf(stderr, "No positions in %s\n", positions_path.c_str());
+        return 1;
+    }
+
+    json settings;
+    settings["Bot"]["NoRandom"] = true;
+    settings["Bot"]["BotScoringType"] = "NumberAndPotential";
+    settings["Bot"]["Optimization"] = "O1";
+    AnalysisService service(settings, threads, hash_mb);
+
+    const auto start = chrono::steady_clock::now();
+    vector<future<analysis_result>> results;
+    for (int copy = 0; copy < copies; ++copy)
+    {
+        for (const auto& p : positions)
+        {
+            analysis_job job;
+            if (!Position::from_string(p.text, job.pos))
+            {
+                fprintf(stderr, "Invalid position: %s\n", p.text.c_str());
+                return 1;
+            }
+            job.color = p.color;
+            job.depth = depth;
+            job.priority = (copy == 0 ? 1 : 0);
+            if (time_ms > 0)
+                job.deadline = chrono::steady_clock::now() + chrono::milliseconds(time_ms);
+            results.push_back(service.submit(job));
+        }
+    }
+
+    json report;
+    report["depth"] = depth;
+    report["threads"] = service.size();
+    report["jobs"] = results.size();
+    uint64_t total_nodes = 0;
+    int late = 0;
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        const analysis_result res = results[i].get();
+        total_nodes += res.nodes;
+        late += res.late;
+        if (i >= positions.size())
+            continue; // Повторы печатаются только в итоге
+        json entry;
+        entry["position"] = positions[i].text;
+        entry["side"] = (positions[i].color ? "b" : "w");
+        entry["move"] = (res.line.empty() ? string() : line_to_string(res.line));
+        entry["depth"] = res.depth;
+        entry["score"] = res.score;
+        entry["nodes"] = res.nodes;
+        report["positions"].push_back(entry);
+    }
+    const double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    report["total"]["nodes"] = total_nodes;
+    report["total"]["time_ms"] = seconds * 1000;
+    report["total"]["jobs_per_second"] = (seconds > 0 ? results.size() / seconds : 0.0);
+    report["total"]["nps"] = (seconds > 0 ? uint64_t(total_nodes / seconds) : 0);
+    report["total"]["late"] = late;
+    cout << report.dump(2) << endl;
+    return 0;
+}
@@ -0,0 +1,161 @@
+// Замер скорости поиска на фиксированном наборе позиций.
+// Использование: Bench [глубина = 10] [позиции = positions.txt] [эталон.json] [порог, % = 10] [потоков = 1]
+//                [сеть NNUE] (без сети позиции оцениваются подсчетом материала)
+//
+// Каждая позиция ищется новым экземпляром Logic с пустой таблицей транспозиций и NoRandom, поэтому
+// результат воспроизводим. Результат печатается в JSON: узлы, время, узлы в секунду и выбранный ход.
+// Если задан эталон (сохраненный вывод прошлого запуска), то отмечаются позиции, где изменился ход или
+// число узлов выросло больше порога, а также падение общей скорости больше порога; при регрессиях код
+// возврата 1
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "logic.h"
+
+using namespace std;
+
+// Позиция набора
+struct bench_position
+{
+    string text; // Запись Position::to_string
+    bool color;  // Очередь хода
+};
+
+vector<bench_position> load_positions(const string& path)
+{
+    vector<bench_position> res;
+    ifstream fin(path);
+    string line;
+    while (getline(fin, line))
+    {
+        istringstream in(line);
+        string text, side;
+        if (!(in >> text) || text[0] == '#')
+            continue;
+        in >> side;
+        res.push_back({ text, side == "b" });
+    }
+    return res;
+}
+
+int main(int argc, char** argv)
+{
+    const int depth = (argc > 1 ? atoi(argv[1]) : 10);
+    const string positions_path = (argc > 2 ? argv[2] : "positions.txt");
+    const string baseline_path = (argc > 3 ? argv[3] : "");
+    const double threshold = (argc > 4 ? atof(argv[4]) : 10.0) / 100.0;
+    const int threads = (argc > 5 ? max(1, atoi(argv[5])) : 1);
+    const string nnue_path = (argc > 6 ? argv[6] : "");
+
+    const auto positions = load_positions(positions_path);
+    if (positions.empty())
+    {
+        fprintf(stderr, "No positions in %s\n", positions_path.c_str());
+        return 1;
+    }
+
+    json settings;
+    settings["Bot"]["NoRandom"] = true;
+    settings["Bot"]["BotScoringType"] = "NumberAndPotential";
+    settings["Bot"]["Optimization"] = "O1";
+    settings["Bot"]["Threads"] = threads;
+    if (!nnue_path.empty())
+    {
+        settings["Bot"]["Evaluator"] = "NNUE";
+        settings["Bot"]["NnuePath"] = nnue_path;
+    }
+    Config config(settings);
+
+    json report;
+    report["depth"] = depth;
+    report["threads"] = threads;
+    report["evaluator"] = (nnue_path.empty() ? string("Classic") : string("NNUE ") + nnue_simd_name());
+    uint64_t total_nodes = 0;
+    double total_ms = 0;
+    for (const auto& bench : positions)
+    {
+        Position pos;
+        if (!Position::from_string(bench.text, pos))
+        {
+            fprintf(stderr, "Invalid position: %s\n", bench.text.c_str());
+            return 1;
+        }
+        Logic logic(nullptr, &config);
+        logic.Max_depth = depth;
+        const auto start = chrono::steady_clock::now();
+        const auto line = logic.find_best_turns(pos, bench.color);
+        const double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        const uint64_t nodes = logic.nodes();
+        total_nodes += nodes;
+        total_ms += ms;
+
+        json entry;
+        entry["position"] = bench.text;
+        entry["side"] = (bench.color ? "b" : "w");
+        entry["nodes"] = nodes;
+        entry["time_ms"] = ms;
+        entry["nps"] = (ms > 0 ? uint64_t(nodes * 1000.0 / ms) : 0);
+        entry["move"] = (line.empty() ? string() : line_to_string(line));
+        report["positions"].push_back(entry);
+    }
+    report["total"]["nodes"] = total_nodes;
+    report["total"]["time_ms"] = total_ms;
+    report["total"]["nps"] = (total_ms > 0 ? uint64_t(total_nodes * 1000.0 / total_ms) : 0);
+
+    // Сравнение с эталоном
+    int regressions = 0;
+    if (!baseline_path.empty())
+    {
+        json baseline;
+        ifstream fin(baseline_path);
+        if (!fin)
+        {
+            fprintf(stderr, "Cannot read %s\n", baseline_path.c_str());
+            return 1;
+        }
+        fin >> baseline;
+        json flags = json::array();
+        if (baseline.value("depth", 0) != depth)
+            flags.push_back("baseline depth " + to_string(baseline.value("depth", 0)) + " differs");
+        for (auto& entry : report["positions"])
+        {
+            for (const auto& old : baseline["positions"])
+            {
+                if (old["position"] != entry["position"] || old["side"] != entry["side"])
+                    continue;
+                entry["baseline_nodes"] = old["nodes"];
+                entry["baseline_move"] = old["move"];
+                if (old["move"] != entry["move"])
+                {
+                    flags.push_back(entry["position"].get<string>() + ": move " + old["move"].get<string>() +
+                        " -> " + entry["move"].get<string>());
+                }
+                if (entry["nodes"].get<double>() > old["nodes"].get<double>() * (1.0 + threshold))
+                {
+                    flags.push_back(entry["position"].get<string>() + ": nodes " + to_string(old["nodes"].get<uint64_t>()) +
+                        " -> " + to_string(entry["nodes"].get<uint64_t>()));
+                }
+                break;
+            }
+        }
+        const double old_nps = baseline["total"]["nps"].get<double>();
+        if (report["total"]["nps"].get<double>() < old_nps * (1.0 - threshold))
+        {
+            flags.push_back("total nps " + to_string(uint64_t(old_nps)) + " -> " +
+                to_string(report["total"]["nps"].get<uint64_t>()));
+        }
+        report["baseline_total_nps"] = old_nps;
+        report["regressions"] = flags;
+        regressions = int(flags.size());
+    }
+
+    cout << report.dump(2) << endl;
+    return regressions ? 1 : 0;
+}
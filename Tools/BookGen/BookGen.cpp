@@ -0,0 +1,125 @@
+// Построение дебютной книги по партиям бота против самого себя.
+// Использование: BookGen [партий = 1000] [полуходов в книге = 10] [глубина = 4] [файл = book.bin] [потоков]
+//
+// Каждая партия начинается с начальной расстановки и играется ботом со своим зерном случайных чисел,
+// поэтому равные по оценке ходы выбираются по-разному. Для первых полуходов запоминаются позиция, ход
+// и результат партии. Вес хода в книге - 2 очка за каждую победу и 1 за каждую ничью сыгравшей его стороны;
+// ходы, сыгранные реже min_games раз или не набравшие очков, в книгу не попадают
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "logic.h"
+
+using namespace std;
+
+const int MAX_GAME_PLIES = 120; // Партия, не закончившаяся за это число полуходов, считается ничьей
+const int MIN_GAMES = 2;        // Наименьшее число партий, в которых должен встретиться ход книги
+
+// Статистика хода книги
+struct move_stats
+{
+    uint32_t games = 0; // Число партий с этим ходом
+    uint32_t points = 0; // Очки сыгравшей ход стороны: 2 за победу, 1 за ничью
+};
+
+// Ход партии: ключ позиции и ключ позиции после хода
+struct game_move
+{
+    uint64_t key;
+    uint64_t result_key;
+    bool color;
+};
+
+// Настройки бота для партий
+json bot_settings()
+{
+    json settings;
+    settings["Bot"]["NoRandom"] = false;
+    settings["Bot"]["BotScoringType"] = "NumberAndPotential";
+    settings["Bot"]["Optimization"] = "O1";
+    settings["Bot"]["HashSizeMB"] = 16;
+    return settings;
+}
+
+// Партия бота против самого себя. Возвращает первые book_plies ходов и победителя (0 - белые, 1 - черные, -1 - ничья)
+int play_game(Logic& logic, const unsigned seed, const int book_plies, vector<game_move>& moves)
+{
+    logic.new_game(seed);
+    Position pos = Position::start();
+    for (int ply = 0; ply < MAX_GAME_PLIES; ++ply)
+    {
+        const bool color = ply % 2;
+        const auto line = logic.find_best_turns(pos, color);
+        if (line.empty())
+            return !color; // Ходов нет - проиграл тот, чья очередь
+        const uint64_t key = pos.node_key(color);
+        for (const auto& turn : line)
+            pos.make_move(turn);
+        if (ply < book_plies)
+            moves.push_back({ key, pos.node_key(!color), color });
+    }
+    return -1;
+}
+
+int main(int argc, char** argv)
+{
+    const int games = (argc > 1 ? atoi(argv[1]) : 1000);
+    const int book_plies = (argc > 2 ? atoi(argv[2]) : 10);
+    const int depth = (argc > 3 ? atoi(argv[3]) : 4);
+    const string path = (argc > 4 ? argv[4] : "book.bin");
+    const size_t threads = (argc > 5 ? size_t(max(1, atoi(argv[5]))) : max(1u, thread::hardware_concurrency()));
+
+    const auto start = chrono::steady_clock::now();
+    map<pair<uint64_t, uint64_t>, move_stats> stats;
+    int results[3] = {}; // Белые, черные, ничьи
+    mutex stats_mtx;
+    atomic<int> next_game{ 0 };
+    ThreadPool pool(threads);
+    pool.run_on_all([&](size_t) {
+        // Logic один на поток: новая таблица транспозиций на каждую партию дробила бы кучу
+        Config config(bot_settings());
+        Logic logic(nullptr, &config);
+        logic.Max_depth = depth;
+        for (int game = next_game++; game < games; game = next_game++)
+        {
+            vector<game_move> moves;
+            const int winner = play_game(logic, unsigned(game + 1), book_plies, moves);
+            lock_guard<mutex> lock(stats_mtx);
+            ++results[winner == -1 ? 2 : winner];
+            for (const game_move& move : moves)
+            {
+                move_stats& s = stats[{ move.key, move.result_key }];
+                ++s.games;
+                s.points += (winner == -1 ? 1 : (winner == int(move.color) ? 2 : 0));
+            }
+        }
+    });
+
+    OpeningBook book;
+    size_t book_moves = 0;
+    for (const auto& [keys, s] : stats)
+    {
+        if (s.games < MIN_GAMES || s.points == 0)
+            continue;
+        book.add(keys.first, keys.second, s.points);
+        ++book_moves;
+    }
+    if (!book.save(path))
+    {
+        fprintf(stderr, "Cannot write %s\n", path.c_str());
+        return 1;
+    }
+    printf("%d games: white %d, black %d, draws %d\n", games, results[0], results[1], results[2]);
+    printf("Book: %zu positions, %zu moves, %.2f s\n", book.size(), book_moves,
+        chrono::duration<double>(chrono::steady_clock::now() - start).count());
+    return 0;
+}
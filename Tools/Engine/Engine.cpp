@@ -0,0 +1,298 @@
+// Движок без окна с текстовым протоколом: команды построчно читаются из stdin, ответы пишутся в stdout.
+// Использование: Engine [настройки.json]  (раздел "Bot" в формате settings.json)
+//
+// Команды:
+//   position start|<позиция> [w|b] [moves <ход> ...]  позиция (запись Position::to_string) и ходы после неё
+//   setoption <имя> <значение>   настройка раздела Bot (HashSizeMB, Threads, Evaluator, NnuePath, ...);
+//                                значение - число, true / false или строка; применяется к следующему поиску
+//   newgame                      очистка таблицы транспозиций и истории отсечений
+//   go [depth N] [movetime MS] [nodes N]
+//                                поиск в фоне; без параметров - до глубины MAX_DEPTH или команды stop
+//   go infinite                  поиск без ограничений; bestmove выводится только после stop, даже если
+//                                поиск закончился раньше
+//   stop                         досрочное окончание поиска
+//   isready                      ответ readyok
+//   quit
+// Ответы:
+//   info depth D score cp S|win P|loss P nodes N nps N time MS pv <ход> ...   после каждой итерации
+//                                P - число полуходов до конца партии. Если выигрыш найден по эндшпильным
+//                                таблицам (Bot/TablebasePath), P - полуходы до позиции из таблицы плюс число
+//                                ходов от неё до конца партии по таблице (серия взятий - один ход)
+//   bestmove <ход>|none
+//   info string <сообщение>      ошибки команд
+// Ход записывается как в line_to_string: "c3-d4" или серия взятий "c3:e5:c7"
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "logic.h"
+
+using namespace std;
+
+const int MAX_DEPTH = MAX_SEARCH_PLY / 2; // Глубина поиска без ограничения глубины
+
+mutex out_mtx; // Ответы пишут и поток команд, и поток поиска
+
+void reply(const string& text)
+{
+    lock_guard<mutex> lock(out_mtx);
+    cout << text << endl;
+}
+
+// Оценка для протокола: выигрыш и проигрыш - с числом полуходов до конца партии. Выигрыш, найденный
+// перебором, оценивается выше TB_WIN_SCORE, выигрыш по эндшпильным таблицам - не выше
+string score_to_string(const int score)
+{
+    if (score > TB_WIN_SCORE)
+        return "win " + to_string(WIN_SCORE - score);
+    if (score >= TB_WIN_SCORE - MAX_PLY / 2)
+        return "win " + to_string(TB_WIN_SCORE - score);
+    if (score < -TB_WIN_SCORE)
+        return "loss " + to_string(WIN_SCORE + score);
+    if (score <= MAX_PLY / 2 - TB_WIN_SCORE)
+        return "loss " + to_string(TB_WIN_SCORE + score);
+    return "cp " + to_string(score);
+}
+
+string info_to_string(const search_info& info)
+{
+    ostringstream out;
+    out << "info depth " << info.depth << " score " << score_to_string(info.score) << " nodes " << info.nodes
+        << " nps " << (info.time_ms > 0 ? uint64_t(info.nodes * 1000.0 / info.time_ms) : 0) << " time "
+        << int64_t(info.time_ms) << " pv";
+    for (const auto& line : info.pv)
+        out << ' ' << line_to_string(line);
+    return out.str();
+}
+
+// Первый допустимый ход (с первым продолжением серии взятий) - ответ, если поиск остановлен до конца
+// первой итерации
+vector<move_pos> first_line(Position pos, const bool color)
+{
+    vector<move_pos> line;
+    MoveList list;
+    const bool beats = generate_turns(pos, color, list);
+    if (list.empty())
+        return line;
+    move_pos turn = list[0];
+    pos.make_move(turn);
+    line.push_back(turn);
+    while (beats && generate_turns(pos, turn.x2, turn.y2, list))
+    {
+        turn = list[0];
+        pos.make_move(turn);
+        line.push_back(turn);
+    }
+    return line;
+}
+
+class Engine
+{
+public:
+    explicit Engine(const json& settings) : settings(settings)
+    {
+    }
+
+    ~Engine()
+    {
+        stop();
+    }
+
+    // Обработка одной команды; false - команда quit
+    bool command(const string& text)
+    {
+        istringstream in(text);
+        string name;
+        if (!(in >> name))
+            return true;
+        if (name == "quit")
+            return false;
+        if (name == "isready")
+            reply("readyok");
+        else if (name == "position")
+            set_position(in);
+        else if (name == "setoption")
+            set_option(in);
+        else if (name == "newgame")
+        {
+            stop();
+            if (logic)
+                logic->new_game(0);
+        }
+        else if (name == "go")
+            go(in);
+        else if (name == "stop")
+            stop();
+        else
+            reply("info string unknown command " + name);
+        return true;
+    }
+
+private:
+    void set_position(istringstream& in)
+    {
+        string text, token;
+        in >> text;
+        Position new_pos = Position::start();
+        bool new_color = false;
+        if (text != "start" && !Position::from_string(text, new_pos))
+        {
+            reply("info string invalid position " + text);
+            return;
+        }
+        while (in >> token)
+        {
+            if (token == "w" || token == "b")
+                new_color = (token == "b");
+            else if (token == "moves")
+                break;
+        }
+        while (in >> token)
+        {
+            vector<move_pos> line;
+            if (!parse_line(new_pos, new_color, token, line))
+            {
+                reply("info string invalid move " + token);
+                return;
+            }
+            for (const auto& turn : line)
+                new_pos.make_move(turn);
+            new_color = !new_color;
+        }
+        stop();
+        pos = new_pos;
+        color = new_color;
+    }
+
+    void set_option(istringstream& in)
+    {
+        string name, value;
+        in >> name;
+        getline(in >> ws, value);
+        if (name.empty())
+        {
+            reply("info string setoption needs a name");
+            return;
+        }
+        const json parsed = json::parse(value, nullptr, false);
+        settings["Bot"][name] = (parsed.is_discarded() || parsed.is_object() || parsed.is_array() ? json(value) : parsed);
+        stop();
+        logic.reset(); // Logic создается заново при следующем поиске
+    }
+
+    void go(istringstream& in)
+    {
+        int depth = MAX_DEPTH, time_ms = 0;
+        uint64_t nodes = 0;
+        bool infinite = false;
+        string token;
+        while (in >> token)
+        {
+            bool valid = true;
+            if (token == "infinite")
+                infinite = true;
+            else if (token == "depth")
+                valid = bool(in >> depth);
+            else if (token == "movetime")
+                valid = bool(in >> time_ms);
+            else if (token == "nodes")
+                valid = bool(in >> nodes);
+            else
+                valid = false;
+            if (!valid)
+            {
+                reply("info string invalid go parameter " + token);
+                return;
+            }
+        }
+        if (infinite)
+        {
+            depth = MAX_DEPTH;
+            time_ms = 0;
+            nodes = 0;
+        }
+        stop();
+        if (!logic)
+        {
+            config = make_unique<Config>(settings);
+            logic = make_unique<Logic>(nullptr, config.get());
+            logic->on_iteration = [](const search_info& info) { reply(info_to_string(info)); };
+        }
+        logic->Max_depth = max(0, min(depth, MAX_DEPTH));
+        logic->set_limits(time_ms, nodes);
+        logic->start_search(pos, color);
+        stop_requested = false;
+        waiter = thread([this, infinite, start_pos = pos, start_color = color]() {
+            auto line = logic->search_result();
+            if (infinite)
+            {
+                unique_lock<mutex> lock(stop_mtx);
+                stop_cv.wait(lock, [this] { return stop_requested; });
+            }
+            if (line.empty())
+                line = first_line(start_pos, start_color);
+            reply("bestmove " + (line.empty() ? string("none") : line_to_string(line)));
+        });
+    }
+
+    // Остановка текущего поиска и ожидание его ответа bestmove
+    void stop()
+    {
+        if (!waiter.joinable())
+            return;
+        {
+            lock_guard<mutex> lock(stop_mtx);
+            stop_requested = true;
+        }
+        stop_cv.notify_all();
+        logic->stop_search();
+        waiter.join();
+    }
+
+    json settings; // Настройки бота
+    unique_ptr<Config> config;
+    unique_ptr<Logic> logic;
+    thread waiter; // Поток, ожидающий окончания поиска и выводящий bestmove
+    mutex stop_mtx;
+    condition_variable stop_cv; // Поиск go infinite ждет команды stop
+    bool stop_requested = false;
+    Position pos = Position::start();
+    bool color = false; // Очередь хода
+};
+
+int main(int argc, char** argv)
+{
+    json settings;
+    settings["Bot"]["NoRandom"] = true;
+    settings["Bot"]["BotScoringType"] = "NumberAndPotential";
+    settings["Bot"]["Optimization"] = "O1";
+    settings["Bot"]["HashSizeMB"] = 64;
+    if (argc > 1)
+    {
+        ifstream fin(argv[1]);
+        const json values = json::parse(fin, nullptr, false);
+        if (values.is_discarded() || !values.contains("Bot"))
+        {
+            fprintf(stderr, "Cannot read settings %s\n", argv[1]);
+            return 1;
+        }
+        settings.merge_patch(values);
+    }
+
+    Engine engine(settings);
+    string line;
+    while (getline(cin, line))
+    {
+        if (!engine.command(line))
+            break;
+    }
+    return 0;
+}
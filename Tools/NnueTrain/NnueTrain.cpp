@@ -0,0 +1,374 @@
+// Обучение сети оценки NNUE по партиям бота против самого себя.
+// Использование: NnueTrain [партий = 2000] [глубина разметки = 6] [эпох = 30] [файл = nnue.bin] [потоков]
+//
+// Первые RANDOM_PLIES полуходов каждой партии делаются случайно, дальше играет бот с подсчетом материала.
+// Каждая спокойная позиция партии (без взятий у стороны, чей ход) размечается оценкой поиска на заданную
+// глубину, цель обучения - смесь вероятности выигрыша по этой оценке и результата партии. Сеть обучается
+// в числах с плавающей точкой (Adam, квадратичная ошибка), затем веса квантуются в формат Nnue.h
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "logic.h"
+
+using namespace std;
+
+const int RANDOM_PLIES = 6; // Случайные полуходы в начале партии для разнообразия позиций
+const int PLAY_DEPTH = 4; // Глубина поиска бота в партиях
+const int MAX_GAME_PLIES = 150; // Партия, не закончившаяся за это число полуходов, считается ничьей
+const double SIGMOID_SCALE = 200.0; // Оценка, при которой вероятность выигрыша равна 1 / (1 + e^-1)
+const double RESULT_WEIGHT = 0.3; // Доля результата партии в цели обучения
+const int MAX_LABEL = 2000; // Ограничение оценок выигрыша при разметке
+const int BATCH_SIZE = 256;
+const double LEARNING_RATE = 1e-3;
+
+// Позиция для обучения
+struct train_sample
+{
+    Position pos;
+    bool color = false; // Очередь хода
+    int score = 0; // Оценка поиска с точки зрения color
+    double result = 0.5; // Результат партии для color: 1 - победа, 0.5 - ничья, 0 - поражение
+};
+
+double sigmoid(const double x)
+{
+    return 1.0 / (1.0 + exp(-x));
+}
+
+// Настройки бота для партий
+json bot_settings()
+{
+    json settings;
+    settings["Bot"]["NoRandom"] = false;
+    settings["Bot"]["BotScoringType"] = "NumberAndPotential";
+    settings["Bot"]["Optimization"] = "O1";
+    settings["Bot"]["HashSizeMB"] = 8;
+    return settings;
+}
+
+// Партия бота против самого себя, спокойные позиции партии добавляются в samples
+void play_game(Logic& logic, const unsigned seed, vector<train_sample>& samples)
+{
+    logic.new_game(seed);
+    mt19937 rng(seed);
+
+    Position pos = Position::start();
+    const size_t first = samples.size();
+    int winner = -1; // 0 - белые, 1 - черные, -1 - ничья
+    for (int ply = 0; ply < MAX_GAME_PLIES; ++ply)
+    {
+        const bool color = ply % 2;
+        MoveList list;
+        const bool beats = generate_turns(pos, color, list);
+        if (list.empty())
+        {
+            winner = !color; // Ходов нет - проиграл тот, чья очередь
+            break;
+        }
+        if (!beats && ply >= RANDOM_PLIES)
+            samples.push_back({ pos, color, 0, 0.5 });
+        if (ply < RANDOM_PLIES)
+        {
+            // Случайный ход, для взятий - случайное продолжение серии
+            move_pos turn = list[int(rng() % unsigned(list.size()))];
+            pos.make_move(turn);
+            while (turn.xb != -1 && generate_turns(pos, turn.x2, turn.y2, list))
+            {
+                turn = list[int(rng() % unsigned(list.size()))];
+                pos.make_move(turn);
+            }
+            continue;
+        }
+        for (const auto& turn : logic.find_best_turns(pos, color))
+            pos.make_move(turn);
+    }
+    for (size_t i = first; i < samples.size(); ++i)
+        samples[i].result = (winner == -1 ? 0.5 : (winner == int(samples[i].color) ? 1.0 : 0.0));
+}
+
+// Сеть в числах с плавающей точкой: та же архитектура, что и в Nnue.h
+struct FloatNetwork
+{
+    vector<float> w1 = vector<float>(NNUE_INPUTS * NNUE_HIDDEN);
+    vector<float> b1 = vector<float>(NNUE_HIDDEN);
+    vector<float> w2 = vector<float>(NNUE_L2 * 2 * NNUE_HIDDEN);
+    vector<float> b2 = vector<float>(NNUE_L2);
+    vector<float> w3 = vector<float>(NNUE_L2);
+    vector<float> b3 = vector<float>(1);
+
+    vector<vector<float>*> params()
+    {
+        return { &w1, &b1, &w2, &b2, &w3, &b3 };
+    }
+};
+
+// Промежуточные значения прямого прохода, нужные для обратного
+struct forward_state
+{
+    int features[2][32]; // Входы каждой стороны
+    int count = 0; // Число фигур
+    float acc[2 * NNUE_HIDDEN]; // Аккумулятор: сначала сторона, чей ход, затем соперник
+    float x[2 * NNUE_HIDDEN]; // Активации аккумулятора
+    float z2[NNUE_L2];
+    float a2[NNUE_L2];
+    float y = 0; // Выход сети (оценка / NNUE_OUTPUT_SCALE)
+};
+
+float clamp01(const float v)
+{
+    return min(max(v, 0.0f), 1.0f);
+}
+
+void forward(const FloatNetwork& net, const train_sample& s, forward_state& st)
+{
+    st.count = 0;
+    for (uint32_t rest = s.pos.occupied(); rest; rest &= rest - 1)
+    {
+        const int sq = lowest_bit(rest);
+        st.features[0][st.count] = nnue_feature(s.pos.get(sq), sq, s.color);
+        st.features[1][st.count] = nnue_feature(s.pos.get(sq), sq, !s.color);
+        ++st.count;
+    }
+    for (int p = 0; p < 2; ++p)
+    {
+        float* acc = st.acc + p * NNUE_HIDDEN;
+        copy(net.b1.begin(), net.b1.end(), acc);
+        for (int k = 0; k < st.count; ++k)
+        {
+            const float* row = &net.w1[st.features[p][k] * NNUE_HIDDEN];
+            for (int i = 0; i < NNUE_HIDDEN; ++i)
+                acc[i] += row[i];
+        }
+    }
+    for (int i = 0; i < 2 * NNUE_HIDDEN; ++i)
+        st.x[i] = clamp01(st.acc[i]);
+    st.y = net.b3[0];
+    for (int j = 0; j < NNUE_L2; ++j)
+    {
+        const float* row = &net.w2[j * 2 * NNUE_HIDDEN];
+        float z = net.b2[j];
+        for (int i = 0; i < 2 * NNUE_HIDDEN; ++i)
+            z += row[i] * st.x[i];
+        st.z2[j] = z;
+        st.a2[j] = clamp01(z);
+        st.y += net.w3[j] * st.a2[j];
+    }
+}
+
+// Цель обучения и прогноз сети в виде вероятности выигрыша
+double target(const train_sample& s)
+{
+    return RESULT_WEIGHT * s.result + (1 - RESULT_WEIGHT) * sigmoid(s.score / SIGMOID_SCALE);
+}
+
+double predict(const forward_state& st)
+{
+    return sigmoid(st.y * NNUE_OUTPUT_SCALE / SIGMOID_SCALE);
+}
+
+// Обратный проход: градиенты ошибки (p - t)^2 добавляются в grad
+void backward(const FloatNetwork& net, const forward_state& st, const double t, FloatNetwork& grad)
+{
+    const double p = predict(st);
+    const float gy = float(2 * (p - t) * p * (1 - p) * NNUE_OUTPUT_SCALE / SIGMOID_SCALE);
+    grad.b3[0] += gy;
+    float gx[2 * NNUE_HIDDEN] = {};
+    for (int j = 0; j < NNUE_L2; ++j)
+    {
+        grad.w3[j] += gy * st.a2[j];
+        if (st.z2[j] <= 0 || st.z2[j] >= 1)
+            continue;
+        const float gz = gy * net.w3[j];
+        grad.b2[j] += gz;
+        const float* row = &net.w2[j * 2 * NNUE_HIDDEN];
+        float* grow = &grad.w2[j * 2 * NNUE_HIDDEN];
+        for (int i = 0; i < 2 * NNUE_HIDDEN; ++i)
+        {
+            grow[i] += gz * st.x[i];
+            gx[i] += gz * row[i];
+        }
+    }
+    for (int p2 = 0; p2 < 2; ++p2)
+    {
+        for (int i = 0; i < NNUE_HIDDEN; ++i)
+        {
+            const float a = st.acc[p2 * NNUE_HIDDEN + i];
+            const float g = (a > 0 && a < 1 ? gx[p2 * NNUE_HIDDEN + i] : 0.0f);
+            if (g == 0)
+                continue;
+            grad.b1[i] += g;
+            for (int k = 0; k < st.count; ++k)
+                grad.w1[st.features[p2][k] * NNUE_HIDDEN + i] += g;
+        }
+    }
+}
+
+// Квантование весов в формат Nnue.h
+void quantize(const FloatNetwork& net, NnueNetwork& q)
+{
+    auto to_int = [](const float v, const float scale, const float limit) {
+        return int(lround(min(max(v * scale, -limit), limit)));
+    };
+    for (int f = 0; f < NNUE_INPUTS; ++f)
+        for (int i = 0; i < NNUE_HIDDEN; ++i)
+            q.w1[f][i] = int16_t(to_int(net.w1[f * NNUE_HIDDEN + i], NNUE_QA, 1000));
+    for (int i = 0; i < NNUE_HIDDEN; ++i)
+        q.b1[i] = int16_t(to_int(net.b1[i], NNUE_QA, 8000));
+    for (int j = 0; j < NNUE_L2; ++j)
+    {
+        for (int i = 0; i < 2 * NNUE_HIDDEN; ++i)
+            q.w2[j][i] = int8_t(to_int(net.w2[j * 2 * NNUE_HIDDEN + i], NNUE_QB, 127));
+        q.b2[j] = to_int(net.b2[j], NNUE_QA * NNUE_QB, 1e9f);
+        q.w3[j] = int8_t(to_int(net.w3[j], NNUE_QB, 127));
+    }
+    q.b3 = to_int(net.b3[0], NNUE_QA * NNUE_QB, 1e9f);
+}
+
+int main(int argc, char** argv)
+{
+    const int games = (argc > 1 ? atoi(argv[1]) : 2000);
+    const int label_depth = (argc > 2 ? atoi(argv[2]) : 6);
+    const int epochs = (argc > 3 ? atoi(argv[3]) : 30);
+    const string path = (argc > 4 ? argv[4] : "nnue.bin");
+    const size_t threads = (argc > 5 ? size_t(max(1, atoi(argv[5]))) : max(1u, thread::hardware_concurrency()));
+    const auto start = chrono::steady_clock::now();
+    auto elapsed = [&start]() { return chrono::duration<double>(chrono::steady_clock::now() - start).count(); };
+
+    // Партии и разметка позиций оценкой поиска
+    vector<train_sample> samples;
+    mutex samples_mtx;
+    atomic<int> next_game{ 0 };
+    ThreadPool pool(threads);
+    pool.run_on_all([&](size_t) {
+        TransTable table(16);
+        SearchShared shared;
+        shared.tt = &table;
+        SearchWorker worker(&shared);
+        // Logic один на поток: новая таблица транспозиций на каждую партию дробила бы кучу
+        Config config(bot_settings());
+        Logic logic(nullptr, &config);
+        logic.Max_depth = PLAY_DEPTH;
+        for (int game = next_game++; game < games; game = next_game++)
+        {
+            vector<train_sample> game_samples;
+            play_game(logic, unsigned(game + 1), game_samples);
+            for (train_sample& s : game_samples)
+            {
+                worker.set_root(s.pos);
+                const int score = worker.find_best_turns_rec<SearchPolicy<true, true>>(s.pos, s.color, label_depth,
+                    -INF, INF, 0);
+                s.score = min(max(score, -MAX_LABEL), MAX_LABEL);
+            }
+            lock_guard<mutex> lock(samples_mtx);
+            samples.insert(samples.end(), game_samples.begin(), game_samples.end());
+        }
+    });
+    printf("%d games, %zu positions, %.1f s\n", games, samples.size(), elapsed());
+    if (samples.size() < 100)
+    {
+        fprintf(stderr, "Too few positions\n");
+        return 1;
+    }
+
+    // Проверочная выборка - каждая двадцатая позиция
+    mt19937 rng(1);
+    shuffle(samples.begin(), samples.end(), rng);
+    const size_t valid_count = samples.size() / 20;
+    const vector<train_sample> valid(samples.begin(), samples.begin() + valid_count);
+    samples.erase(samples.begin(), samples.begin() + valid_count);
+
+    // Начальные веса: нейроны аккумулятора в середине отрезка активации
+    FloatNetwork net, grad, m, v;
+    normal_distribution<float> w1_dist(0.0f, 0.1f), w2_dist(0.0f, 1.0f / 16), w3_dist(0.0f, 0.2f);
+    for (float& w : net.w1)
+        w = w1_dist(rng);
+    fill(net.b1.begin(), net.b1.end(), 0.5f);
+    for (float& w : net.w2)
+        w = w2_dist(rng);
+    fill(net.b2.begin(), net.b2.end(), 0.5f);
+    for (float& w : net.w3)
+        w = w3_dist(rng);
+
+    auto loss = [&net](const vector<train_sample>& set) {
+        double sum = 0;
+        forward_state st;
+        for (const train_sample& s : set)
+        {
+            forward(net, s, st);
+            const double d = predict(st) - target(s);
+            sum += d * d;
+        }
+        return sum / double(set.size());
+    };
+
+    // Обучение: Adam по мини-выборкам, после шага веса ограничиваются диапазоном квантования
+    const float w_limit = 127.0f / NNUE_QB;
+    const double beta1 = 0.9, beta2 = 0.999;
+    int step = 0;
+    forward_state st;
+    for (int epoch = 1; epoch <= epochs; ++epoch)
+    {
+        shuffle(samples.begin(), samples.end(), rng);
+        for (size_t batch = 0; batch < samples.size(); batch += BATCH_SIZE)
+        {
+            const size_t end = min(samples.size(), batch + BATCH_SIZE);
+            for (auto* g : grad.params())
+                fill(g->begin(), g->end(), 0.0f);
+            for (size_t i = batch; i < end; ++i)
+            {
+                forward(net, samples[i], st);
+                backward(net, st, target(samples[i]), grad);
+            }
+            ++step;
+            const double lr = LEARNING_RATE * sqrt(1 - pow(beta2, step)) / (1 - pow(beta1, step));
+            const auto params = net.params(), grads = grad.params(), ms = m.params(), vs = v.params();
+            for (size_t k = 0; k < params.size(); ++k)
+            {
+                for (size_t i = 0; i < params[k]->size(); ++i)
+                {
+                    const float g = (*grads[k])[i] / float(end - batch);
+                    float& mi = (*ms[k])[i];
+                    float& vi = (*vs[k])[i];
+                    mi = float(beta1 * mi + (1 - beta1) * g);
+                    vi = float(beta2 * vi + (1 - beta2) * g * g);
+                    (*params[k])[i] -= float(lr * mi / (sqrt(vi) + 1e-8));
+                }
+            }
+            for (float& w : net.w2)
+                w = min(max(w, -w_limit), w_limit);
+            for (float& w : net.w3)
+                w = min(max(w, -w_limit), w_limit);
+        }
+        printf("epoch %d: train %.6f, valid %.6f, %.1f s\n", epoch, loss(samples), loss(valid), elapsed());
+    }
+
+    // Квантование и проверка расхождения с вещественной сетью
+    auto quantized = make_unique<NnueNetwork>();
+    quantize(net, *quantized);
+    double diff = 0;
+    for (const train_sample& s : valid)
+    {
+        forward(net, s, st);
+        NnueAccumulator acc;
+        nnue_refresh(*quantized, s.pos, acc);
+        diff += fabs(nnue_evaluate(*quantized, acc, s.color) - st.y * NNUE_OUTPUT_SCALE);
+    }
+    printf("Quantization error: %.2f (mean abs, score units), %s kernels\n", diff / double(valid.size()),
+        nnue_simd_name());
+    if (!quantized->save(path))
+    {
+        fprintf(stderr, "Cannot write %s\n", path.c_str());
+        return 1;
+    }
+    printf("Saved %s, %.1f s\n", path.c_str(), elapsed());
+    return 0;
+}
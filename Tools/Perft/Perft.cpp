@@ -0,0 +1,170 @@
+// Подсчет числа позиций на заданной глубине (perft) для проверки и замера скорости генератора ходов.
+// Использование: Perft [глубина = 8] [потоков] [хеш, МБ = 0] [позиция] [w|b] [divide]
+//
+// Позиция задается строкой Position::to_string или словом start (начальная расстановка), w / b - очередь хода.
+// Ход - полная серия взятий или одиночный ход, как в игре. На последнем полуходе тихие ходы не выполняются,
+// а просто считаются. Корневые ходы делятся между потоками, хеш-таблица у потоков общая; с divide печатается
+// число позиций после каждого
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "MoveGen.h"
+#include "Position.h"
+#include "ThreadPool.h"
+
+using namespace std;
+
+// Запись хеш-таблицы: число позиций под узлом. Как в TransTable, вместо ключа (ключ узла вместе с глубиной)
+// хранится key ^ count: запись, которую одновременно писали два потока, не совпадет с ключом
+struct perft_entry
+{
+    atomic<uint64_t> key_xor_count{ 0 };
+    atomic<uint64_t> count{ 0 };
+};
+
+// Хеш-таблица результатов поддеревьев, общая для всех потоков
+class PerftHash
+{
+public:
+    explicit PerftHash(const size_t size_mb) : table(entry_count(size_mb)), mask(table.empty() ? 0 : table.size() - 1)
+    {
+    }
+
+    bool enabled() const
+    {
+        return !table.empty();
+    }
+
+    bool probe(const uint64_t key, uint64_t& count) const
+    {
+        const perft_entry& entry = table[key & mask];
+        const uint64_t stored = entry.count.load(memory_order_relaxed);
+        if ((entry.key_xor_count.load(memory_order_relaxed) ^ stored) != key)
+            return false;
+        count = stored;
+        return true;
+    }
+
+    void store(const uint64_t key, const uint64_t count)
+    {
+        perft_entry& entry = table[key & mask];
+        entry.count.store(count, memory_order_relaxed);
+        entry.key_xor_count.store(key ^ count, memory_order_relaxed);
+    }
+
+private:
+    // Наибольшая степень двойки записей, которая помещается в size_mb мегабайт (0 - таблица не нужна)
+    static size_t entry_count(const size_t size_mb)
+    {
+        if (size_mb == 0)
+            return 0;
+        size_t count = 1;
+        while (count * 2 * sizeof(perft_entry) <= size_mb * 1024 * 1024)
+            count *= 2;
+        return count;
+    }
+
+    vector<perft_entry> table;
+    size_t mask = 0;
+};
+
+uint64_t perft(Position& pos, const bool color, const int depth, PerftHash& hash);
+
+// Продолжение серии взятий фигурой с клетки (x, y)
+uint64_t perft_series(Position& pos, const bool color, const POS_T x, const POS_T y, const int depth, PerftHash& hash)
+{
+    MoveList list;
+    if (!generate_turns(pos, x, y, list))
+        return (depth == 1 ? 1 : perft(pos, !color, depth - 1, hash)); // Серия закончилась, ход переходит
+    uint64_t nodes = 0;
+    for (const move_pos& turn : list)
+    {
+        const undo_info undo = pos.make_move(turn);
+        nodes += perft_series(pos, color, turn.x2, turn.y2, depth, hash);
+        pos.unmake_move(turn, undo);
+    }
+    return nodes;
+}
+
+// Число позиций через depth ходов от позиции с очередью color
+uint64_t perft(Position& pos, const bool color, const int depth, PerftHash& hash)
+{
+    if (depth == 0)
+        return 1;
+    MoveList list;
+    const bool beats = generate_turns(pos, color, list);
+    if (depth == 1 && !beats)
+        return uint64_t(list.size()); // Последний полуход без взятий: ходы только считаются
+
+    const uint64_t key = pos.node_key(color) ^ (uint64_t(depth) * 0x9E3779B97F4A7C15ull);
+    uint64_t nodes = 0;
+    if (hash.enabled() && hash.probe(key, nodes))
+        return nodes;
+    for (const move_pos& turn : list)
+    {
+        const undo_info undo = pos.make_move(turn);
+        nodes += (beats ? perft_series(pos, color, turn.x2, turn.y2, depth, hash)
+                        : perft(pos, !color, depth - 1, hash));
+        pos.unmake_move(turn, undo);
+    }
+    if (hash.enabled())
+        hash.store(key, nodes);
+    return nodes;
+}
+
+int main(int argc, char** argv)
+{
+    const int depth = (argc > 1 ? atoi(argv[1]) : 8);
+    const size_t threads = (argc > 2 ? size_t(max(1, atoi(argv[2]))) : max(1u, thread::hardware_concurrency()));
+    const size_t hash_mb = (argc > 3 ? size_t(max(0, atoi(argv[3]))) : 0);
+    Position pos = Position::start();
+    if (argc > 4 && string(argv[4]) != "start" && !Position::from_string(argv[4], pos))
+    {
+        fprintf(stderr, "Invalid position: %s\n", argv[4]);
+        return 1;
+    }
+    const bool color = (argc > 5 && argv[5][0] == 'b');
+    const bool divide = (argc > 6 && string(argv[6]) == "divide");
+    if (depth < 1)
+    {
+        fprintf(stderr, "Depth must be positive\n");
+        return 1;
+    }
+
+    // Корневые ходы собирает тот же код, что и у поиска
+    const vector<vector<move_pos>> lines = generate_lines(pos, color);
+
+    const auto start = chrono::steady_clock::now();
+    vector<uint64_t> counts(lines.size());
+    atomic<size_t> next_line{ 0 };
+    PerftHash hash(hash_mb);
+    ThreadPool pool(threads);
+    pool.run_on_all([&](size_t) {
+        for (size_t i = next_line++; i < lines.size(); i = next_line++)
+        {
+            Position thread_pos = pos;
+            for (const auto& turn : lines[i])
+                thread_pos.make_move(turn);
+            counts[i] = perft(thread_pos, !color, depth - 1, hash);
+        }
+    });
+    const double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    uint64_t total = 0;
+    for (size_t i = 0; i < lines.size(); ++i)
+    {
+        if (divide)
+            printf("%s %llu\n", line_to_string(lines[i]).c_str(), (unsigned long long)counts[i]);
+        total += counts[i];
+    }
+    printf("%s %c\n", pos.to_string().c_str(), color ? 'b' : 'w');
+    printf("perft(%d) = %llu, %.3f s, %.0f nodes/s\n", depth, (unsigned long long)total, seconds,
+        seconds > 0 ? double(total) / seconds : 0.0);
+    return 0;
+}
@@ -0,0 +1,347 @@
+// Построение эндшпильных таблиц ретроградным анализом.
+// Использование: TbGen [число фигур = 4] [каталог = tablebases] [число потоков]
+//                TbGen check <каталог> <позиция> [w|b] [глубина = 4]
+//
+// Таблицы строятся по возрастанию числа фигур, а при равном числе фигур - по возрастанию числа пешек:
+// взятие уменьшает число фигур, а превращение - число пешек, поэтому все такие ходы ведут в уже построенные
+// таблицы. Тихие ходы ведут в таблицу того же материала с переставленными цветами, поэтому эта пара таблиц
+// решается вместе. Проход номер n находит позиции, которые заканчиваются ровно за n ходов: выигрыш - если
+// лучший ход ведет в проигрыш соперника за n - 1 ход, проигрыш - если все ходы ведут в выигрыш соперника и
+// самый долгий из них - за n - 1 ход. Проходы идут, пока появляются новые позиции или в построенных таблицах
+// есть позиции дольше n ходов; оставшиеся позиции - ничьи.
+//
+// check разыгрывает решенную позицию ботом с этими таблицами за обе стороны и проверяет, что выигрыш
+// реализован не дольше, чем за число ходов из таблицы
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "MoveGen.h"
+#include "Position.h"
+#include "Tablebase.h"
+#include "ThreadPool.h"
+#include "logic.h"
+
+using namespace std;
+
+// Решенная позиция, найденная потоком за проход
+struct tb_change
+{
+    int table;      // Номер таблицы в решаемой паре
+    uint64_t index; // Номер позиции
+    uint8_t code;   // Код позиции (tb_code)
+};
+
+class TbGenerator
+{
+public:
+    TbGenerator(const string& dir, const size_t threads) : dir(dir), pool(threads), finished(TB_MATERIAL_COUNT)
+    {
+    }
+
+    void build(const int max_pieces)
+    {
+        for (int total = 2; total <= max_pieces; ++total)
+        {
+            vector<tb_material> order;
+            for (int wm = 0; wm <= total; ++wm)
+                for (int wk = 0; wm + wk <= total; ++wk)
+                    for (int bm = 0; wm + wk + bm <= total; ++bm)
+                    {
+                        const tb_material mat(wm, wk, bm, total - wm - wk - bm);
+                        if (mat.wm + mat.wk > 0 && mat.bm + mat.bk > 0)
+                            order.push_back(mat);
+                    }
+            stable_sort(order.begin(), order.end(),
+                [](const tb_material& a, const tb_material& b) { return a.wm + a.bm < b.wm + b.bm; });
+            for (const tb_material& mat : order)
+            {
+                if (finished[mat.id()].empty())
+                    solve_pair(mat);
+            }
+        }
+    }
+
+private:
+    // Решение таблицы материала mat вместе с таблицей переставленных цветов
+    void solve_pair(const tb_material& mat)
+    {
+        const auto start = chrono::steady_clock::now();
+        materials.assign(1, mat);
+        if (!(mat.swapped() == mat))
+            materials.push_back(mat.swapped());
+
+        // Начальное состояние: невозможные позиции отмечаются, остальные пока считаются ничьими
+        work.assign(materials.size(), vector<uint8_t>());
+        for (size_t t = 0; t < materials.size(); ++t)
+        {
+            work[t].assign(materials[t].size(), TB_DRAW_CODE);
+            for (uint64_t i = 0; i < work[t].size(); ++i)
+            {
+                uint32_t white, black, kings;
+                if (!tb_position(i, materials[t], white, black, kings))
+                    work[t][i] = TB_INVALID_CODE;
+            }
+        }
+
+        int distance = 0;
+        while (run_pass(distance) || distance <= finished_distance)
+        {
+            if (++distance > TB_MAX_DISTANCE)
+            {
+                fprintf(stderr, "%s: win longer than %d moves\n", mat.file_name().c_str(), TB_MAX_DISTANCE);
+                exit(1);
+            }
+        }
+
+        for (size_t t = 0; t < materials.size(); ++t)
+            save(t);
+
+        const double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        for (size_t t = 0; t < materials.size(); ++t)
+        {
+            uint64_t counts[4] = {};
+            int longest = 0;
+            for (const uint8_t code : work[t])
+            {
+                const TbValue value = tb_value(code);
+                ++counts[int(value)];
+                if (value == TbValue::WIN)
+                    longest = max(longest, tb_distance(code));
+            }
+            printf("%s: %llu positions, win %llu, loss %llu, draw %llu, longest win %d\n",
+                materials[t].file_name().c_str(), (unsigned long long)(counts[0] + counts[1] + counts[2]),
+                (unsigned long long)counts[1], (unsigned long long)counts[2], (unsigned long long)counts[0], longest);
+        }
+        printf("  %d passes, %.2f s\n", distance + 1, seconds);
+        fflush(stdout);
+    }
+
+    // Проход по нерешенным позициям пары, находит позиции, которые заканчиваются ровно за distance ходов.
+    // Новые значения применяются после прохода, чтобы потоки читали неизменные таблицы. Возвращает true,
+    // если решена хотя бы одна позиция
+    bool run_pass(const int distance)
+    {
+        const uint64_t CHUNK = 4096;
+        vector<uint64_t> offsets(1, 0);
+        for (const auto& table : work)
+            offsets.push_back(offsets.back() + table.size());
+        atomic<uint64_t> next{ 0 };
+        vector<vector<tb_change>> changes(pool.size());
+
+        pool.run_on_all([&](const size_t thread_index) {
+            for (uint64_t begin = next.fetch_add(CHUNK); begin < offsets.back(); begin = next.fetch_add(CHUNK))
+            {
+                const uint64_t end = min(begin + CHUNK, offsets.back());
+                for (uint64_t n = begin; n < end; ++n)
+                {
+                    const int t = int(upper_bound(offsets.begin(), offsets.end(), n) - offsets.begin()) - 1;
+                    const uint64_t i = n - offsets[t];
+                    if (work[t][i] != TB_DRAW_CODE)
+                        continue;
+                    const uint8_t code = solve_position(t, i, distance);
+                    if (code != TB_DRAW_CODE)
+                        changes[thread_index].push_back({ t, i, code });
+                }
+            }
+        });
+
+        bool changed = false;
+        for (const auto& list : changes)
+        {
+            for (const tb_change& change : list)
+                work[change.table][change.index] = change.code;
+            changed |= !list.empty();
+        }
+        return changed;
+    }
+
+    // Код позиции с ходом белых, если она заканчивается ровно за distance ходов, по известным значениям
+    // позиций после каждого хода. TB_DRAW_CODE означает, что позиция пока не решена
+    uint8_t solve_position(const int t, const uint64_t index, const int distance) const
+    {
+        uint32_t white, black, kings;
+        tb_position(index, materials[t], white, black, kings);
+        Position pos(white, black, kings);
+        bool all_win = true;
+        int fastest_win = TB_MAX_DISTANCE + 1, slowest_loss = 0;
+        for_each_successor(pos, -1, -1, [&](const Position& next) {
+            const uint8_t code = successor_code(next);
+            const TbValue value = tb_value(code);
+            if (value == TbValue::WIN)
+                slowest_loss = max(slowest_loss, tb_distance(code) + 1);
+            else
+                all_win = false;
+            if (value == TbValue::LOSS)
+                fastest_win = min(fastest_win, tb_distance(code) + 1); // Ход в проигранную для соперника позицию
+            return fastest_win != distance; // Более быстрый выигрыш был бы найден на прошлых проходах
+        });
+        if (fastest_win == distance)
+            return tb_code(distance);
+        if (all_win && slowest_loss == distance)
+            return tb_code(distance); // Ходов нет или все ходы ведут к выигрышу соперника
+        return TB_DRAW_CODE;
+    }
+
+    // Код позиции после хода белых для соперника, который теперь ходит
+    uint8_t successor_code(const Position& next) const
+    {
+        const uint32_t white = reverse_bits(next.black), black = reverse_bits(next.white);
+        const uint32_t kings = reverse_bits(next.kings);
+        if (!white)
+            return tb_code(0); // У соперника не осталось фигур - он проиграл
+        const tb_material mat(white, black, kings);
+        const uint64_t index = tb_index(white, black, kings, mat);
+        for (size_t t = 0; t < materials.size(); ++t)
+        {
+            if (materials[t] == mat)
+                return work[t][index];
+        }
+        return finished[mat.id()][index];
+    }
+
+    // Перебор всех ходов белых до конца серии взятий. visit вызывается для каждой итоговой позиции
+    // и возвращает false, если перебор можно прекратить
+    template <class Visit>
+    static bool for_each_successor(Position& pos, const POS_T x, const POS_T y, Visit&& visit)
+    {
+        MoveList list;
+        const bool beats = (x != -1 ? generate_turns(pos, x, y, list) : generate_turns(pos, false, list));
+        if (x != -1 && !beats)
+            return visit(pos); // Серия взятий закончилась
+        for (const move_pos& turn : list)
+        {
+            const undo_info undo = pos.make_move(turn);
+            const bool go = (beats ? for_each_successor(pos, turn.x2, turn.y2, visit) : visit(pos));
+            pos.unmake_move(turn, undo);
+            if (!go)
+                return false;
+        }
+        return true;
+    }
+
+    // Запись таблицы в файл
+    void save(const size_t t)
+    {
+        const tb_material& mat = materials[t];
+        for (const uint8_t code : work[t])
+        {
+            if (code != TB_DRAW_CODE && code != TB_INVALID_CODE)
+                finished_distance = max(finished_distance, tb_distance(code));
+        }
+
+        tb_header header;
+        header.wm = uint8_t(mat.wm);
+        header.wk = uint8_t(mat.wk);
+        header.bm = uint8_t(mat.bm);
+        header.bk = uint8_t(mat.bk);
+        header.count = mat.size();
+        ofstream fout(dir + "/" + mat.file_name(), ios::binary);
+        fout.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        fout.write(reinterpret_cast<const char*>(work[t].data()), streamsize(work[t].size()));
+        if (!fout)
+        {
+            fprintf(stderr, "Cannot write %s/%s\n", dir.c_str(), mat.file_name().c_str());
+            exit(1);
+        }
+        finished[mat.id()] = work[t];
+    }
+
+    string dir;                        // Каталог для файлов таблиц
+    ThreadPool pool;                   // Потоки для проходов по позициям
+    vector<vector<uint8_t>> finished;  // Коды позиций построенных таблиц по номеру материала
+    int finished_distance = 0;         // Наибольшее число ходов до конца партии в построенных таблицах
+    vector<tb_material> materials;     // Решаемая пара материалов
+    vector<vector<uint8_t>> work;      // Коды позиций решаемой пары
+};
+
+// Розыгрыш решенной позиции ботом с таблицами из dir за обе стороны. Успех - если партия закончилась
+// победой стороны, выигрывающей по таблице, не позже, чем за число ходов из таблицы
+int check_conversion(const string& dir, const string& text, const bool start_color, const int depth)
+{
+    Position pos;
+    if (!Position::from_string(text, pos))
+    {
+        fprintf(stderr, "Invalid position: %s\n", text.c_str());
+        return 1;
+    }
+    json settings;
+    settings["Bot"]["NoRandom"] = true;
+    settings["Bot"]["BotScoringType"] = "NumberAndPotential";
+    settings["Bot"]["Optimization"] = "O1";
+    settings["Bot"]["HashSizeMB"] = 16;
+    settings["Bot"]["Threads"] = 1;
+    settings["Bot"]["TablebasePath"] = dir;
+    Config config(settings);
+    Logic logic(nullptr, &config);
+    logic.Max_depth = depth;
+
+    Tablebase tablebase;
+    TbValue value;
+    int distance;
+    if (tablebase.load(dir, MAX_TB_PIECES) == 0 || !tablebase.probe(pos, start_color, value, distance) ||
+        value == TbValue::DRAW)
+    {
+        fprintf(stderr, "Position %s is not a win or a loss in %s\n", text.c_str(), dir.c_str());
+        return 1;
+    }
+    const bool winner = (value == TbValue::WIN ? start_color : !start_color);
+
+    bool color = start_color;
+    int moves = 0;
+    string game;
+    for (; moves <= distance; ++moves, color = !color)
+    {
+        const auto line = logic.find_best_turns(pos, color);
+        if (line.empty())
+            break; // Ходов нет - проиграл тот, чья очередь
+        game += (game.empty() ? "" : " ") + line_to_string(line);
+        for (const auto& turn : line)
+            pos.make_move(turn);
+    }
+    printf("%s %s: %s, table %d moves, game %d moves: %s\n", text.c_str(), start_color ? "b" : "w",
+        value == TbValue::WIN ? "win" : "loss", distance, moves, game.c_str());
+    if (moves > distance || color == winner)
+    {
+        fprintf(stderr, "The win was not converted in %d moves\n", distance);
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc > 1 && string(argv[1]) == "check")
+    {
+        if (argc < 4)
+        {
+            fprintf(stderr, "Usage: TbGen check <dir> <position> [w|b] [depth]\n");
+            return 1;
+        }
+        const bool color = (argc > 4 && string(argv[4]) == "b");
+        return check_conversion(argv[2], argv[3], color, argc > 5 ? max(1, atoi(argv[5])) : 4);
+    }
+
+    const int pieces = (argc > 1 ? atoi(argv[1]) : 4);
+    const string dir = (argc > 2 ? argv[2] : "tablebases");
+    const size_t threads = (argc > 3 ? size_t(max(1, atoi(argv[3]))) : max(1u, thread::hardware_concurrency()));
+    if (pieces < 2 || pieces > MAX_TB_PIECES)
+    {
+        fprintf(stderr, "Number of pieces must be between 2 and %d\n", MAX_TB_PIECES);
+        return 1;
+    }
+    filesystem::create_directories(dir);
+
+    const auto start = chrono::steady_clock::now();
+    TbGenerator generator(dir, threads);
+    generator.build(pieces);
+    printf("Done in %.2f s\n", chrono::duration<double>(chrono::steady_clock::now() - start).count());
+    return 0;
+}
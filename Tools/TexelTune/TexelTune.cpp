@@ -0,0 +1,279 @@
+// Подбор параметров оценки подсчетом материала методом Texel по результатам партий бота против самого себя.
+// Использование: TexelTune [позиции = texel.txt] [партий = 2000] [параметры = eval.json] [потоков]
+//
+// Если файла позиций нет, он создается: партии начинаются с RANDOM_PLIES случайных полуходов, дальше
+// играет бот, и каждая спокойная позиция (без взятий у стороны, чей ход) записывается строкой
+// "позиция w|b результат", где результат - 1, 0.5 или 0 для белых. Оценка позиции линейна по параметрам,
+// поэтому ошибка (результат - sigmoid(оценка / S))^2 и её градиент считаются точно: сначала подбирается
+// масштаб S при исходных параметрах, затем параметры - градиентным спуском (Adam). Позиции делятся
+// между потоками, каждый считает сумму по своей части. Результат записывается в JSON-файл, который
+// Logic загружает по настройке Bot/EvalParamsPath
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "logic.h"
+
+using namespace std;
+
+const int RANDOM_PLIES = 8; // Случайные полуходы в начале партии для разнообразия позиций
+const int PLAY_DEPTH = 4; // Глубина поиска бота в партиях
+const int MAX_GAME_PLIES = 150; // Партия, не закончившаяся за это число полуходов, считается ничьей
+const int ITERATIONS = 2000; // Шаги градиентного спуска
+const double LEARNING_RATE = 0.5; // Шаг Adam в единицах оценки
+
+// Позиция с результатом партии
+struct texel_position
+{
+    string text; // Запись Position::to_string
+    bool color = false; // Очередь хода
+    double result = 0.5; // Результат партии для белых
+};
+
+// Признаки позиции, на которые умножаются параметры: разности белых и черных
+struct texel_features
+{
+    double men = 0; // Пешки
+    double kings = 0; // Дамки
+    double potential = 0; // Продвижение пешек
+    double result = 0.5; // Результат партии для белых
+};
+
+// Подбираемые параметры (стоимость пешки - единица оценки и не меняется)
+struct texel_params
+{
+    double king = 5 * MAN_SCORE;
+    double potential = POTENTIAL_SCORE;
+};
+
+// Настройки бота для партий
+json bot_settings()
+{
+    json settings;
+    settings["Bot"]["NoRandom"] = false;
+    settings["Bot"]["BotScoringType"] = "NumberAndPotential";
+    settings["Bot"]["Optimization"] = "O1";
+    settings["Bot"]["HashSizeMB"] = 8;
+    return settings;
+}
+
+// Партия бота против самого себя, спокойные позиции партии добавляются в positions
+void play_game(Logic& logic, const unsigned seed, vector<texel_position>& positions)
+{
+    logic.new_game(seed);
+    mt19937 rng(seed);
+
+    Position pos = Position::start();
+    const size_t first = positions.size();
+    double result = 0.5;
+    for (int ply = 0; ply < MAX_GAME_PLIES; ++ply)
+    {
+        const bool color = ply % 2;
+        MoveList list;
+        const bool beats = generate_turns(pos, color, list);
+        if (list.empty())
+        {
+            result = (color ? 1.0 : 0.0); // Ходов нет - проиграл тот, чья очередь
+            break;
+        }
+        if (!beats && ply >= RANDOM_PLIES)
+            positions.push_back({ pos.to_string(), color, 0.5 });
+        if (ply < RANDOM_PLIES)
+        {
+            // Случайный ход, для взятий - случайное продолжение серии
+            move_pos turn = list[int(rng() % unsigned(list.size()))];
+            pos.make_move(turn);
+            while (turn.xb != -1 && generate_turns(pos, turn.x2, turn.y2, list))
+            {
+                turn = list[int(rng() % unsigned(list.size()))];
+                pos.make_move(turn);
+            }
+            continue;
+        }
+        for (const auto& turn : logic.find_best_turns(pos, color))
+            pos.make_move(turn);
+    }
+    for (size_t i = first; i < positions.size(); ++i)
+        positions[i].result = result;
+}
+
+vector<texel_position> load_positions(const string& path)
+{
+    vector<texel_position> res;
+    ifstream fin(path);
+    string line;
+    while (getline(fin, line))
+    {
+        istringstream in(line);
+        texel_position p;
+        string side;
+        if (in >> p.text >> side >> p.result)
+        {
+            p.color = (side == "b");
+            res.push_back(p);
+        }
+    }
+    return res;
+}
+
+// Ошибка и её градиент по параметрам для всех позиций, позиции делятся между потоками пула
+struct texel_error
+{
+    double loss = 0;
+    double grad_king = 0;
+    double grad_potential = 0;
+};
+
+texel_error evaluate(ThreadPool& pool, const vector<texel_features>& data, const texel_params& params,
+    const double scale)
+{
+    vector<texel_error> partial(pool.size());
+    pool.run_on_all([&](const size_t thread_index) {
+        texel_error& e = partial[thread_index];
+        for (size_t i = thread_index; i < data.size(); i += pool.size())
+        {
+            const texel_features& f = data[i];
+            const double eval = MAN_SCORE * f.men + params.king * f.kings + params.potential * f.potential;
+            const double p = 1.0 / (1.0 + exp(-eval / scale));
+            const double d = p - f.result;
+            e.loss += d * d;
+            const double g = 2 * d * p * (1 - p) / scale; // Производная ошибки по оценке
+            e.grad_king += g * f.kings;
+            e.grad_potential += g * f.potential;
+        }
+    });
+    texel_error total;
+    for (const texel_error& e : partial)
+    {
+        total.loss += e.loss / double(data.size());
+        total.grad_king += e.grad_king / double(data.size());
+        total.grad_potential += e.grad_potential / double(data.size());
+    }
+    return total;
+}
+
+int main(int argc, char** argv)
+{
+    const string positions_path = (argc > 1 ? argv[1] : "texel.txt");
+    const int games = (argc > 2 ? atoi(argv[2]) : 2000);
+    const string params_path = (argc > 3 ? argv[3] : "eval.json");
+    const size_t threads = (argc > 4 ? size_t(max(1, atoi(argv[4]))) : max(1u, thread::hardware_concurrency()));
+    const auto start = chrono::steady_clock::now();
+    auto elapsed = [&start]() { return chrono::duration<double>(chrono::steady_clock::now() - start).count(); };
+    ThreadPool pool(threads);
+
+    // Позиции из файла или новые партии
+    vector<texel_position> positions = load_positions(positions_path);
+    if (positions.empty())
+    {
+        mutex positions_mtx;
+        atomic<int> next_game{ 0 };
+        pool.run_on_all([&](size_t) {
+            // Logic один на поток: новая таблица транспозиций на каждую партию дробила бы кучу
+            Config config(bot_settings());
+            Logic logic(nullptr, &config);
+            logic.Max_depth = PLAY_DEPTH;
+            for (int game = next_game++; game < games; game = next_game++)
+            {
+                vector<texel_position> game_positions;
+                play_game(logic, unsigned(game + 1), game_positions);
+                lock_guard<mutex> lock(positions_mtx);
+                positions.insert(positions.end(), game_positions.begin(), game_positions.end());
+            }
+        });
+        ofstream fout(positions_path);
+        for (const texel_position& p : positions)
+            fout << p.text << ' ' << (p.color ? 'b' : 'w') << ' ' << p.result << '\n';
+        printf("%d games, %zu positions written to %s, %.1f s\n", games, positions.size(), positions_path.c_str(),
+            elapsed());
+    }
+    else
+    {
+        printf("%zu positions loaded from %s\n", positions.size(), positions_path.c_str());
+    }
+
+    vector<texel_features> data;
+    for (const texel_position& p : positions)
+    {
+        Position pos;
+        if (!Position::from_string(p.text, pos))
+            continue;
+        data.push_back({ double(pos.count[1] - pos.count[2]), double(pos.count[3] - pos.count[4]),
+            double(pos.potential[0] - pos.potential[1]), p.result });
+    }
+    if (data.empty())
+    {
+        fprintf(stderr, "No positions\n");
+        return 1;
+    }
+
+    // Масштаб S: перебор с уменьшающимся шагом при исходных параметрах
+    texel_params params;
+    double scale = 100, step = 50;
+    double best_loss = evaluate(pool, data, params, scale).loss;
+    while (step > 0.5)
+    {
+        bool improved = false;
+        for (const double candidate : { scale - step, scale + step })
+        {
+            if (candidate <= 0)
+                continue;
+            const double loss = evaluate(pool, data, params, candidate).loss;
+            if (loss < best_loss)
+            {
+                best_loss = loss;
+                scale = candidate;
+                improved = true;
+            }
+        }
+        if (!improved)
+            step /= 2;
+    }
+    printf("Scale %.1f, initial error %.6f (king %.0f, potential %.1f)\n", scale, best_loss, params.king,
+        params.potential);
+
+    // Градиентный спуск по параметрам
+    double m[2] = {}, v[2] = {};
+    const double beta1 = 0.9, beta2 = 0.999;
+    for (int it = 1; it <= ITERATIONS; ++it)
+    {
+        const texel_error e = evaluate(pool, data, params, scale);
+        const double grad[2] = { e.grad_king, e.grad_potential };
+        double* values[2] = { &params.king, &params.potential };
+        for (int k = 0; k < 2; ++k)
+        {
+            m[k] = beta1 * m[k] + (1 - beta1) * grad[k];
+            v[k] = beta2 * v[k] + (1 - beta2) * grad[k] * grad[k];
+            const double m_hat = m[k] / (1 - pow(beta1, it)), v_hat = v[k] / (1 - pow(beta2, it));
+            *values[k] -= LEARNING_RATE * m_hat / (sqrt(v_hat) + 1e-12);
+        }
+        if (it % 500 == 0)
+            printf("iteration %d: error %.6f (king %.1f, potential %.2f)\n", it, e.loss, params.king, params.potential);
+    }
+
+    json res;
+    res["ManScore"] = MAN_SCORE;
+    res["KingScore"] = int(lround(params.king));
+    res["PotentialScore"] = int(lround(params.potential));
+    ofstream fout(params_path);
+    fout << res.dump(2) << endl;
+    if (!fout)
+    {
+        fprintf(stderr, "Cannot write %s\n", params_path.c_str());
+        return 1;
+    }
+    printf("Final error %.6f, parameters written to %s: %s, %.1f s\n", evaluate(pool, data, params, scale).loss,
+        params_path.c_str(), res.dump().c_str(), elapsed());
+    return 0;
+}
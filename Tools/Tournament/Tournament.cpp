@@ -0,0 +1,245 @@
+// Матч двух настроек бота без окна: партии играются параллельно, по одной на поток.
+// Использование: Tournament <настройки A.json> <настройки B.json> [партий = 2000] [потоков] [elo0 = 0] [elo1 = 10]
+//
+// Файл настроек - раздел "Bot" в формате settings.json (можно указать сам settings.json); ключи, которых
+// в нем нет, берутся из bot_defaults. Глубина - Bot/BotLevel, если её нет - Bot/WhiteBotLevel.
+// Партии играются парами: дебют из RANDOM_PLIES случайных полуходов (серия взятий - один полуход)
+// разыгрывается дважды со сменой цвета. Партия без победителя за MAX_GAME_PLIES полуходов или с
+// троекратным повторением позиции - ничья. Elo A относительно B и его 95% интервал считаются по очкам
+// пар (пентаномиальная модель). SPRT проверяет гипотезы elo = elo0 против elo = elo1 с ошибками
+// ALPHA и BETA и останавливает матч, как только отношение правдоподобия выходит за границы
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "logic.h"
+
+using namespace std;
+
+const int RANDOM_PLIES = 6; // Случайные полуходы дебюта
+const int MAX_GAME_PLIES = 200; // Партия, не закончившаяся за это число полуходов, считается ничьей
+const double ALPHA = 0.05; // Вероятность принять elo1, если верна elo0
+const double BETA = 0.05; // Вероятность принять elo0, если верна elo1
+const int REPORT_PAIRS = 50; // Промежуточный отчет через это число пар
+
+// Настройки бота, не заданные в файле
+json bot_defaults()
+{
+    json settings;
+    settings["Bot"]["NoRandom"] = true;
+    settings["Bot"]["BotScoringType"] = "NumberAndPotential";
+    settings["Bot"]["Optimization"] = "O1";
+    settings["Bot"]["HashSizeMB"] = 16;
+    settings["Bot"]["BotLevel"] = 6;
+    return settings;
+}
+
+bool load_settings(const string& path, json& settings)
+{
+    ifstream fin(path);
+    const json values = json::parse(fin, nullptr, false);
+    if (!fin.is_open() || values.is_discarded() || !values.contains("Bot"))
+        return false;
+    settings = bot_defaults();
+    settings.merge_patch(values);
+    if (!values["Bot"].contains("BotLevel") && values["Bot"].contains("WhiteBotLevel"))
+        settings["Bot"]["BotLevel"] = values["Bot"]["WhiteBotLevel"];
+    return true;
+}
+
+// Случайный дебют: список полуходов, каждый - одиночный ход или серия взятий
+vector<vector<move_pos>> random_opening(const unsigned seed)
+{
+    mt19937 rng(seed);
+    for (;;)
+    {
+        Position pos = Position::start();
+        vector<vector<move_pos>> opening;
+        for (int ply = 0; ply < RANDOM_PLIES; ++ply)
+        {
+            MoveList list;
+            generate_turns(pos, ply % 2, list);
+            if (list.empty())
+                break;
+            vector<move_pos> line;
+            move_pos turn = list[int(rng() % unsigned(list.size()))];
+            pos.make_move(turn);
+            line.push_back(turn);
+            while (turn.xb != -1 && generate_turns(pos, turn.x2, turn.y2, list))
+            {
+                turn = list[int(rng() % unsigned(list.size()))];
+                pos.make_move(turn);
+                line.push_back(turn);
+            }
+            opening.push_back(line);
+        }
+        MoveList list;
+        generate_turns(pos, RANDOM_PLIES % 2, list);
+        if (int(opening.size()) == RANDOM_PLIES && !list.empty())
+            return opening; // Дебют не должен заканчивать партию
+    }
+}
+
+// Партия после дебюта; результат для белых: 1 - победа, 0.5 - ничья, 0 - поражение
+double play_game(Logic& white, Logic& black, const vector<vector<move_pos>>& opening)
+{
+    Position pos = Position::start();
+    for (const auto& line : opening)
+        for (const auto& turn : line)
+            pos.make_move(turn);
+    vector<uint64_t> history;
+    for (int ply = int(opening.size()); ply < MAX_GAME_PLIES; ++ply)
+    {
+        const bool color = ply % 2;
+        const uint64_t key = pos.node_key(color);
+        if (count(history.begin(), history.end(), key) >= 2)
+            return 0.5;
+        history.push_back(key);
+        const auto line = (color ? black : white).find_best_turns(pos, color);
+        if (line.empty())
+            return (color ? 1.0 : 0.0); // Ходов нет - проиграл тот, чья очередь
+        for (const auto& turn : line)
+            pos.make_move(turn);
+    }
+    return 0.5;
+}
+
+// Счет матча по парам партий: pairs[k] - число пар, в которых A набрал k / 2 очка
+struct match_stats
+{
+    int pairs[5] = {};
+    int wins = 0, losses = 0, draws = 0;
+
+    int pair_count() const
+    {
+        return pairs[0] + pairs[1] + pairs[2] + pairs[3] + pairs[4];
+    }
+
+    // Средняя доля очков A за пару и её дисперсия
+    void score(double& mean, double& variance) const
+    {
+        const int n = pair_count();
+        mean = variance = 0;
+        if (n == 0)
+            return;
+        for (int k = 0; k < 5; ++k)
+            mean += pairs[k] * (k / 4.0);
+        mean /= n;
+        for (int k = 0; k < 5; ++k)
+            variance += pairs[k] * (k / 4.0 - mean) * (k / 4.0 - mean);
+        variance /= n;
+    }
+
+    // Логарифм отношения правдоподобия elo1 к elo0 (нормальное приближение)
+    double llr(const double elo0, const double elo1) const
+    {
+        double mean, variance;
+        score(mean, variance);
+        if (variance <= 0)
+            return 0;
+        const double s0 = 1.0 / (1.0 + pow(10.0, -elo0 / 400.0));
+        const double s1 = 1.0 / (1.0 + pow(10.0, -elo1 / 400.0));
+        return pair_count() * (s1 - s0) * (2 * mean - s0 - s1) / (2 * variance);
+    }
+};
+
+double score_to_elo(const double score)
+{
+    const double s = min(max(score, 1e-3), 1 - 1e-3);
+    return -400.0 * log10(1.0 / s - 1.0);
+}
+
+void report(const match_stats& stats, const double elo0, const double elo1, const double seconds)
+{
+    double mean, variance;
+    stats.score(mean, variance);
+    const double margin = 1.96 * sqrt(variance / max(1, stats.pair_count()));
+    const double elo = score_to_elo(mean);
+    printf("Games %d: +%d -%d =%d, Elo %.1f +- %.1f, LLR %.2f [%.2f, %.2f], %.0f s\n", 2 * stats.pair_count(),
+        stats.wins, stats.losses, stats.draws, elo,
+        (score_to_elo(mean + margin) - score_to_elo(mean - margin)) / 2, stats.llr(elo0, elo1),
+        log(BETA / (1 - ALPHA)), log((1 - BETA) / ALPHA), seconds);
+    fflush(stdout);
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        fprintf(stderr, "Usage: Tournament <A.json> <B.json> [games] [threads] [elo0] [elo1]\n");
+        return 1;
+    }
+    json settings[2];
+    for (int i = 0; i < 2; ++i)
+    {
+        if (!load_settings(argv[i + 1], settings[i]))
+        {
+            fprintf(stderr, "Cannot read settings %s\n", argv[i + 1]);
+            return 1;
+        }
+    }
+    const int max_pairs = max(1, (argc > 3 ? atoi(argv[3]) : 2000) / 2);
+    const size_t threads = (argc > 4 ? size_t(max(1, atoi(argv[4]))) : max(1u, thread::hardware_concurrency()));
+    const double elo0 = (argc > 5 ? atof(argv[5]) : 0.0);
+    const double elo1 = (argc > 6 ? atof(argv[6]) : 10.0);
+    const double lower = log(BETA / (1 - ALPHA)), upper = log((1 - BETA) / ALPHA);
+
+    const auto start = chrono::steady_clock::now();
+    auto elapsed = [&start]() { return chrono::duration<double>(chrono::steady_clock::now() - start).count(); };
+    match_stats stats;
+    mutex stats_mtx;
+    atomic<int> next_pair{ 0 };
+    atomic<bool> finished{ false };
+    ThreadPool pool(threads);
+    pool.run_on_all([&](size_t) {
+        // Logic каждой стороны один на поток, перед каждой партией таблица транспозиций очищается
+        Config config_a(settings[0]), config_b(settings[1]);
+        Logic a(nullptr, &config_a), b(nullptr, &config_b);
+        a.Max_depth = config_a("Bot", "BotLevel", 6);
+        b.Max_depth = config_b("Bot", "BotLevel", 6);
+        for (int pair = next_pair++; pair < max_pairs && !finished; pair = next_pair++)
+        {
+            const auto opening = random_opening(unsigned(pair + 1));
+            a.new_game(unsigned(pair + 1));
+            b.new_game(unsigned(pair + 1));
+            const double first = play_game(a, b, opening); // A белыми
+            a.new_game(unsigned(pair + 1));
+            b.new_game(unsigned(pair + 1));
+            const double second = 1.0 - play_game(b, a, opening); // A черными
+
+            lock_guard<mutex> lock(stats_mtx);
+            if (finished)
+                break; // Решение уже принято, лишние пары не учитываются
+            ++stats.pairs[int(lround((first + second) * 2))];
+            for (const double result : { first, second })
+            {
+                if (result == 1.0)
+                    ++stats.wins;
+                else if (result == 0.0)
+                    ++stats.losses;
+                else
+                    ++stats.draws;
+            }
+            const double llr = stats.llr(elo0, elo1);
+            if (llr <= lower || llr >= upper)
+                finished = true;
+            if (stats.pair_count() % REPORT_PAIRS == 0 && stats.pair_count() < max_pairs && !finished)
+                report(stats, elo0, elo1, elapsed());
+        }
+    });
+
+    report(stats, elo0, elo1, elapsed());
+    const double llr = stats.llr(elo0, elo1);
+    printf("SPRT elo0 = %.1f, elo1 = %.1f: %s\n", elo0, elo1,
+        llr >= upper ? "H1 accepted" : (llr <= lower ? "H0 accepted" : "inconclusive"));
+    return 0;
+}